@@ -1,6 +1,6 @@
 #!/bin/bash
 
 ml purge
-ml NVHPC ParaStationMPI netCDF
+ml NVHPC ParaStationMPI HDF5 netCDF
 
-mpicc netcdf_dd_read_bench.c -o netcdf_dd_read_bench -lnetcdf
\ No newline at end of file
+mpicc -O3 -mp ddread.c netcdf_dd_read_bench.c -o netcdf_dd_read_bench -lnetcdf -lhdf5
\ No newline at end of file
@@ -0,0 +1,316 @@
+// Internals of the subdomain reader library and the benchmark modes of
+// netcdf_dd_read_bench: box and exchange helpers, two-phase I/O, throttling,
+// grid choice, post-read transforms, interpolation kernels and caches. Not
+// part of the model-facing API of ddread.h
+#ifndef DDBENCH_H
+#define DDBENCH_H
+
+#include "ddread.h"
+#include <netcdf_par.h>
+#include <hdf5.h>
+#include <stdint.h>
+
+double get_time_sec();
+void safe_abort(MPI_Comm comm, int errorcode);
+
+size_t box_size(int ndims, const box_t *box);
+int box_intersect(int ndims, const box_t *a, const box_t *b, box_t *out);
+void box_copy(int ndims, const box_t *region,
+              const box_t *src_box, const float *src,
+              const box_t *dst_box, float *dst);
+void box_fill(int ndims, const box_t *region, const box_t *dst_box, float *dst, float value);
+
+// Workspace for redistributing data between box layouts with MPI_Alltoallv
+typedef struct {
+    float *sendbuf, *recvbuf;
+    size_t sendbuf_size, recvbuf_size;
+    int *sendcounts, *sdispls, *recvcounts, *rdispls;
+} exchange_t;
+
+void exchange_init(exchange_t *ex, int nprocs);
+void exchange_free(exchange_t *ex);
+void exchange_boxes(exchange_t *ex, MPI_Comm comm, int ndims,
+                    int nsrc, const box_t *src_boxes, const float *src,
+                    int ndst, const box_t *dst_boxes, float *dst);
+
+void compute_pieces(int px, int py, int nproc_x, int nproc_y, int halo,
+                    int lon_size, int lat_size, piece_t *pieces);
+int read_pieces(int ncid, int varid, int ndims, int lat_idx, int lon_idx,
+                const piece_t *pieces, int npieces, int use_independent,
+                size_t *start, size_t *count, float *buffer);
+void piece_box(const piece_t *piece, int ndims, const size_t *dimlen,
+               int lat_idx, int lon_idx, box_t *box);
+void compute_all_boxes(int nproc_x, int nproc_y, int halo, int ndims, const size_t *dimlen,
+                       int lat_idx, int lon_idx, int npieces, box_t *all_boxes);
+void cover_box(int px, int py, int nx, int ny, int ndims, const size_t *dimlen,
+               int lat_idx, int lon_idx, box_t *box);
+void slot_box(int slot, int nslots, int ndims, const box_t *box, box_t *out);
+
+// Application-level two-phase I/O. Aggregator ranks read large contiguous
+// blocks of a variable (whole rows along split_dim with all faster dimensions
+// complete, aligned to chunk or stripe boundaries) and redistribute them to
+// the owners of the subdomain pieces with MPI_Alltoallv
+typedef struct {
+    int ndims;
+    MPI_Comm comm;
+    int nprocs, rank;       // Of comm
+    int naggr;              // Number of aggregators
+    int *aggr_ranks;        // Ranks of the aggregators
+    int my_aggr;            // Index of this rank in aggr_ranks, -1 if not an aggregator
+    size_t cb_buffer;       // Maximum block size in bytes
+    size_t align;           // Stripe size in bytes for contiguous variables, 0 to disable
+    unsigned long long *offsets;  // File offset of each variable in bytes, 0 if unknown
+    int npieces;
+    box_t *all_boxes;       // Piece boxes of all ranks (nprocs * npieces)
+    box_t *block_boxes;     // Blocks read by all ranks in the current round (nprocs)
+    float *blockbuf;
+    exchange_t ex;
+} two_phase_t;
+
+void two_phase_init(two_phase_t *tp, const bench_t *b, MPI_Comm comm, int naggr, const char *placement,
+                    size_t cb_buffer, size_t align);
+void two_phase_free(two_phase_t *tp);
+size_t gcd_size(size_t a, size_t b);
+void two_phase_block(int ndims, const size_t *dimlen, int split_dim, size_t outer,
+                     size_t row0, size_t nrows, box_t *box);
+void two_phase_offsets(two_phase_t *tp, const char *path, int nvars,
+                       char (*varnames)[NC_MAX_NAME + 1], MPI_Comm comm);
+int read_var_two_phase(two_phase_t *tp, int ncid, int varid, const size_t *dimlen,
+                       float *buffer);
+
+// Read throttling. At most K ranks of a scope (all ranks or one node) read at
+// the same time. Tokens are handed out either by a ticket counter in an MPI
+// RMA window (next ticket and completed reads, held by scope rank 0) or by a
+// static ring of point-to-point messages in which rank i waits for rank i-K
+enum { THROTTLE_RMA = 0, THROTTLE_RING };
+
+typedef struct {
+    int k;                  // Maximum number of concurrent readers, 0 to disable
+    int method;
+    MPI_Comm comm;
+    int crank, csize;
+    MPI_Win win;
+    long *counters;         // next_ticket, done (only on scope rank 0)
+} throttle_t;
+
+void throttle_init(throttle_t *th, int k, int method, MPI_Comm comm);
+double throttle_acquire(throttle_t *th, int tag);
+void throttle_release(throttle_t *th, int tag);
+void throttle_free(throttle_t *th);
+
+int open_par(const bench_t *b, const char *path, MPI_Comm comm, int use_independent);
+int open_serial(const bench_t *b, const char *path, size_t readahead);
+size_t pieces_size(const bench_t *b, const piece_t *pieces);
+double run_file_parallel(const bench_t *b, int ngroups, int redistribute, double *file_times);
+size_t read_whole_file(const char *path, size_t size, size_t read_size, char *mem);
+void bcast_large(char *mem, size_t size, int root, MPI_Comm comm);
+void run_bcast(const bench_t *b, int node_scope, int use_shm, size_t read_size,
+               double *file_times, double *phase_times);
+herr_t read_pieces_hdf5(const bench_t *b, hid_t dset, hid_t dxpl, float *buffer);
+herr_t read_pieces_sparse(const bench_t *b, hid_t dset, hid_t dxpl, float *buffer, size_t *skipped);
+void run_hdf5(const bench_t *b, int coll_metadata, int sparse, double *file_times,
+              double *open_times, double *first_read_times, double *sparse_times, double *skipped);
+int compare_double(const void *a, const void *b);
+double percentile(const double *sorted, size_t n, double p);
+void run_metadata(const bench_t *b, int comm_size, int repeat, int stagger_us, double *file_times);
+
+// Read tasks of one owner for one variable: every non-empty piece is split
+// into tiles along its first dimension with more than one element, so that
+// each tile is a contiguous part of the piece in the owner's buffer
+typedef struct {
+    int npieces;
+    int ntiles[NPIECES];
+    int split[NPIECES];
+    size_t offset[NPIECES]; // Offset of each piece in the buffer of one variable
+    size_t size;            // Size of the pieces of one variable
+    int per_var;            // Number of tasks per variable
+} task_layout_t;
+
+void task_layout(int ndims, const box_t *boxes, int npieces, int tiles, task_layout_t *tl);
+void task_box(int ndims, const box_t *boxes, const task_layout_t *tl, int t, box_t *box, size_t *offset);
+void run_steal(const bench_t *b, int tiles, int steal, double *file_times, double *idle_times,
+               double *makespans);
+double run_ensemble(const bench_t *b, int members, int shared, double *file_times);
+double read_job_files(const bench_t *b, MPI_Comm job_comm, int job, int njobs, int overlap,
+                      size_t *start, size_t *count, double *file_times);
+void run_interference(const bench_t *b, int njobs, int overlap, int offset_us, double *file_times,
+                      double *solo_times, double *shared_times);
+void compute_load(float *data, size_t n, double seconds);
+void run_ioserver(const bench_t *b, int nservers, double compute_time, double *file_times,
+                  double *stall_times);
+
+int parse_decomp(const char *spec, split_dim_t *split, int max);
+int split_segments(size_t len, int c, const split_dim_t *sd, size_t *start, size_t *count);
+void run_nd(const bench_t *b, double *file_times);
+
+// Candidate process grid with its estimated read cost
+typedef struct {
+    int nproc_x, nproc_y;
+    double requests;     // Read requests of the slowest rank over all data variables
+    double halo_cells;   // Halo cells read by the slowest rank over all data variables
+    double duplication;  // Bytes touched over all ranks per byte of the variable
+    double score;        // Bytes touched by the slowest rank plus its request cost
+    double trial_time;   // Fastest warm read time of the first file, < 0 if not tried
+} grid_score_t;
+
+void score_grid(int nproc_x, int nproc_y, int halo, int ndims, const size_t *dimlen, int lat_idx,
+                int lon_idx, int nvars, const int *chunked, const size_t *chunks, double request_bytes,
+                grid_score_t *gs);
+int compare_grid(const void *a, const void *b);
+grid_score_t choose_grid(int ncid, int nranks, int halo, int ndims, const size_t *dimlen, int lat_idx,
+                         int lon_idx, int nvars, const int *is_dimvar, double request_bytes, int trials);
+void find_level_window(int ncid, const char *dim_name, const char *range, int by_value,
+                       int *level_idx, size_t *level0, size_t *nlevel);
+void report_level_window(int ncid, int nvars, const int *is_dimvar, char (*varnames)[NC_MAX_NAME + 1],
+                         const size_t *dimlen, int level_idx, size_t level0, size_t nlevel);
+size_t piece_counts(const bench_t *b, const size_t *count, size_t (*counts)[MAX_DIMS], size_t *sizes);
+void find_layout(int ncid, const char *spec, int ndims, int *perm);
+void permute_box(int ndims, const size_t *count, const int *perm, const float *src, float *dst);
+int read_pieces_mapped(int ncid, int varid, int ndims, int lat_idx, int lon_idx,
+                       const piece_t *pieces, int npieces, int use_independent, const int *perm,
+                       size_t *start, size_t *count, float *buffer);
+void transpose_2d(const float *src, size_t lds, float *dst, size_t ldd, size_t rows, size_t cols);
+void transform_columns(int ndims, const size_t *count, int col_idx, const float *src, float *dst);
+void transform_interleave(int nfields, size_t n, const float *src, size_t lds, float *dst);
+double interp_probe(const float *data, int nfields, size_t field_stride, const size_t *size,
+                    const size_t *stride, int npoints, unsigned seed, double *sum);
+void transform_subdomain(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                         const float *fields, float *out, float *work);
+void subdomain_strides(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                       size_t *size, size_t *stride, size_t *field_stride);
+double probe_subdomain(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                       const float *data, int npoints, double *sum);
+
+// Layouts produced by the post-read transform, as bits: columns, interleave,
+// and the Morton-tiled layout
+enum { LAYOUT_FILE = 0, LAYOUT_COLUMNS = 1, LAYOUT_INTERLEAVE = 2, LAYOUT_BOTH = 3, LAYOUT_TILED, NLAYOUTS };
+extern const char *layout_names[NLAYOUTS];
+
+// Particle distributions of the interpolation benchmark
+enum { PARTICLES_RANDOM = 0, PARTICLES_CLUSTERED, PARTICLES_SORTED, NPARTICLES };
+extern const char *particle_names[NPARTICLES];
+
+// Morton-ordered tiles of 2^edge_shift elements per side holding the (level,
+// lat, lon) block of the interior piece of each variable. Tiles are stored
+// back to back in the Morton order of their tile coordinates, elements within
+// a tile row-major; tiles at the upper boundaries are padded
+typedef struct {
+    size_t size[3];     // Extents of the block
+    size_t ntiles[3];   // Tiles along each dimension
+    int edge_shift;     // log2 of the tile edge
+    size_t *slot;       // Position in Morton order of tile (tk, ti, tj), row-major
+    size_t n;           // Floats per variable
+} tiled_t;
+
+// Function to get the offset of element (k, i, j) in the tiles of one variable
+static inline size_t tiled_index(const tiled_t *t, size_t k, size_t i, size_t j) {
+    int e = t->edge_shift;
+    size_t m = ((size_t) 1 << e) - 1;
+    size_t tile = t->slot[((k >> e) * t->ntiles[1] + (i >> e)) * t->ntiles[2] + (j >> e)];
+    return (tile << (3 * e)) + ((((k & m) << e) + (i & m)) << e) + (j & m);
+}
+
+void tiled_init(tiled_t *t, const bench_t *b, const size_t *count, int col_idx, int edge);
+void tiled_free(tiled_t *t);
+void tile_subdomain(const tiled_t *t, const bench_t *b, const size_t *count, int col_idx,
+                    const float *fields, float *tiles);
+double interp_tiled(const tiled_t *t, const float *tiles0, const float *tiles1, float wt, int nfields,
+                    const float *pos, size_t n, float *out);
+void page_proxies(const tiled_t *t, const size_t *size, const size_t *stride, const float *pos, size_t n,
+                  double *pages, double *switches);
+void make_particles(const bench_t *b, const size_t *count, int col_idx, int dist, size_t n, float *pos);
+double interp_particles(const float *data0, const float *data1, float wt, int nfields, size_t field_stride,
+                        const size_t *size, const size_t *stride, const float *pos, size_t n, float *out);
+void bench_interp(const bench_t *b, const size_t *count, int col_idx, const float *fields0, const float *fields1,
+                  const float *pos, size_t n, float *out0, float *out1, float *work, float *result,
+                  const tiled_t *tiled, float *tiles0, float *tiles1, double *tile_time, double *times);
+
+// In-memory precision of the read fields: float as read, or one of the
+// 16-bit formats fp16 (IEEE half) and bfloat16
+enum { PRECISION_FLOAT = 0, PRECISION_FP16, PRECISION_BF16, NPRECISIONS };
+extern const char *precision_names[NPRECISIONS];
+
+void encode_half(int precision, const float *src, uint16_t *dst, size_t n);
+void decode_half(int precision, const uint16_t *src, float *dst, size_t n);
+double interp_half(int precision, const uint16_t *data0, const uint16_t *data1, float wt, int nfields,
+                   size_t field_stride, const size_t *size, const size_t *stride, const float *pos, size_t n,
+                   float *out);
+void bench_half(int precision, const bench_t *b, const size_t *count, int col_idx, const float *fields,
+                const uint16_t *half0, uint16_t *half1, const float *pos, size_t n, const float *ref,
+                float *result, float *work, double *times, double *errors, size_t *overflows);
+
+// Store of the Morton tiles of one time level, each tile compressed on its
+// own, with an LRU of decompressed tiles. The LZ4 codec needs HAVE_LZ4
+enum { CODEC_SHUFFLE_LZ = 0, CODEC_LZ4, NCODECS };
+extern const char *codec_names[NCODECS];
+
+typedef struct {
+    const tiled_t *tiled;      // Tile geometry
+    int codec;
+    int nvars;
+    size_t tile_size;          // Floats per tile
+    size_t ntiles;             // Tiles per variable
+    unsigned char **data;      // Compressed tile t of variable v at v * ntiles + t
+    size_t *bytes;             // Compressed sizes, the raw size if kept uncompressed
+    size_t stored_bytes;       // Total of bytes
+    unsigned char *scratch;    // Byte planes and compressed data of one tile
+    int cache_tiles;           // Entries of the LRU
+    float *cache;              // Decompressed tiles of the LRU
+    size_t *cache_key;         // Tile held by each entry
+    unsigned long *cache_used; // Last access of each entry
+    int *where;                // Entry holding each tile, -1 if none
+    unsigned long tick, hits, misses;
+} store_t;
+
+void store_init(store_t *s, const tiled_t *t, int nvars, int codec, int cache_tiles);
+void store_free(store_t *s);
+double store_put(store_t *s, const float *tiles);
+const float *store_tile(store_t *s, int v, size_t t);
+double store_latency(store_t *s);
+double store_interp(store_t *s, const float *tiles, const float *pos, size_t n, float *out);
+
+// Rank-local cache of the subdomain over time: every keyframe-th step is
+// stored whole, the steps in between as deltas to the previous step, each
+// step as one compressed record in a file of its own per rank
+typedef struct {
+    int fd;
+    int writer;         // Opened by the converter, else by the reader
+    int keyframe;       // Steps per keyframe
+    float quant;        // Quantisation step of the deltas, 0 for exact deltas
+    int nvars;
+    size_t n;           // Floats per variable
+    size_t stride;      // Distance of the variables in the caller's buffers
+    int step;           // Next step
+    float *recon;       // Last step as the reader reconstructs it
+    uint32_t *words;    // Keyframe bits or deltas of one step
+    unsigned char *planes, *packed;
+} delta_cache_t;
+
+void delta_open(delta_cache_t *dc, const char *path, int writer, int nvars, size_t n, size_t stride,
+                int keyframe, float quant);
+void delta_close(delta_cache_t *dc);
+size_t delta_write(delta_cache_t *dc, const float *fields, double *error);
+size_t delta_read(delta_cache_t *dc, float *fields, double *times);
+
+// Zarr v2 chunk stores: one directory per netCDF file holding a directory per
+// variable with its JSON metadata (.zarray) and one file per chunk, each
+// compressed on its own. Chunks holding only fill values are not written.
+// The LZ4 codec needs HAVE_LZ4
+enum { ZARR_RAW = 0, ZARR_SHUFFLE_LZ, ZARR_LZ4, NZARR_CODECS };
+extern const char *zarr_codec_names[NZARR_CODECS];
+
+// Metadata of one array of a chunk store
+typedef struct {
+    int ndims;
+    int dims[MAX_DIMS];         // File dimension of each array dimension
+    size_t shape[MAX_DIMS];
+    size_t chunks[MAX_DIMS];
+    int codec;
+    float fill;
+} zarr_array_t;
+
+void zarr_store_path(const char *dir, const char *path, char *store, size_t size);
+double zarr_convert(const bench_t *b, const char *path, const char *store, int codec, size_t edge,
+                    MPI_Comm comm, size_t *bytes);
+
+#endif
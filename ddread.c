@@ -0,0 +1,4593 @@
+// Subdomain reader library used by netcdf_dd_read_bench
+#include "ddbench.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
+// Function to get the current time in seconds for performance measurement
+double get_time_sec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + 1e-6 * tv.tv_usec;
+}
+
+// Function to safely abort MPI processes in case of errors
+void safe_abort(MPI_Comm comm, int errorcode) {
+    fflush(stdout);
+    fflush(stderr);
+    usleep(100000); // 100ms delay to flush output buffers
+    MPI_Abort(comm, errorcode);
+}
+
+// Function to get the number of elements in a box
+size_t box_size(int ndims, const box_t *box) {
+    size_t n = 1;
+    for (int d = 0; d < ndims; d++)
+        n *= box->count[d];
+    return n;
+}
+
+// Function to intersect two boxes. Returns 0 if the intersection is empty
+int box_intersect(int ndims, const box_t *a, const box_t *b, box_t *out) {
+    for (int d = 0; d < ndims; d++) {
+        size_t lo = a->start[d] > b->start[d] ? a->start[d] : b->start[d];
+        size_t hi_a = a->start[d] + a->count[d];
+        size_t hi_b = b->start[d] + b->count[d];
+        size_t hi = hi_a < hi_b ? hi_a : hi_b;
+        if (hi <= lo)
+            return 0;
+        out->start[d] = lo;
+        out->count[d] = hi - lo;
+    }
+    return 1;
+}
+
+// Function to copy the elements of region from array src (laid out as
+// src_box) to array dst (laid out as dst_box), one contiguous row at a time.
+// The region must lie inside both boxes
+void box_copy(int ndims, const box_t *region,
+              const box_t *src_box, const float *src,
+              const box_t *dst_box, float *dst) {
+    size_t n = box_size(ndims, region);
+    if (n == 0)
+        return;
+    size_t row = region->count[ndims - 1];
+    size_t idx[MAX_DIMS] = {0};
+    for (size_t done = 0; done < n; done += row) {
+        size_t soff = 0, doff = 0;
+        for (int d = 0; d < ndims; d++) {
+            size_t i = region->start[d] + idx[d];
+            soff = soff * src_box->count[d] + (i - src_box->start[d]);
+            doff = doff * dst_box->count[d] + (i - dst_box->start[d]);
+        }
+        memcpy(dst + doff, src + soff, row * sizeof(float));
+        for (int d = ndims - 2; d >= 0; d--) {
+            if (++idx[d] < region->count[d]) break;
+            idx[d] = 0;
+        }
+    }
+}
+
+// Function to set the elements of region in array dst (laid out as dst_box)
+// to value, one contiguous row at a time. Rows are cleared with memset if
+// all bytes of value are equal, as for zero, else filled by a vectorised loop
+void box_fill(int ndims, const box_t *region, const box_t *dst_box, float *dst, float value) {
+    size_t n = box_size(ndims, region);
+    if (n == 0)
+        return;
+    unsigned char bytes[sizeof(float)];
+    memcpy(bytes, &value, sizeof(float));
+    int same = bytes[0] == bytes[1] && bytes[0] == bytes[2] && bytes[0] == bytes[3];
+    size_t row = region->count[ndims - 1];
+    size_t idx[MAX_DIMS] = {0};
+    for (size_t done = 0; done < n; done += row) {
+        size_t doff = 0;
+        for (int d = 0; d < ndims; d++)
+            doff = doff * dst_box->count[d] + (region->start[d] + idx[d] - dst_box->start[d]);
+        if (same) {
+            memset(dst + doff, bytes[0], row * sizeof(float));
+        } else {
+            float *out = dst + doff;
+            for (size_t i = 0; i < row; i++)
+                out[i] = value;
+        }
+        for (int d = ndims - 2; d >= 0; d--) {
+            if (++idx[d] < region->count[d]) break;
+            idx[d] = 0;
+        }
+    }
+}
+
+// Function to allocate the exchange workspace for a communicator of nprocs ranks
+void exchange_init(exchange_t *ex, int nprocs) {
+    memset(ex, 0, sizeof(*ex));
+    ex->sendcounts = (int*) malloc(nprocs * sizeof(int));
+    ex->sdispls = (int*) malloc(nprocs * sizeof(int));
+    ex->recvcounts = (int*) malloc(nprocs * sizeof(int));
+    ex->rdispls = (int*) malloc(nprocs * sizeof(int));
+}
+
+// Function to free the exchange workspace
+void exchange_free(exchange_t *ex) {
+    free(ex->sendbuf);
+    free(ex->recvbuf);
+    free(ex->sendcounts);
+    free(ex->sdispls);
+    free(ex->recvcounts);
+    free(ex->rdispls);
+}
+
+// Function to redistribute data between box layouts. Every rank holds the data
+// of nsrc source boxes (src_boxes[r * nsrc + s] for rank r, stored back to back
+// in src) and receives all overlapping data into its ndst target boxes
+// (dst_boxes[r * ndst + t], stored back to back in dst). Empty boxes are
+// allowed as padding. Must be called by all ranks of comm
+void exchange_boxes(exchange_t *ex, MPI_Comm comm, int ndims,
+                    int nsrc, const box_t *src_boxes, const float *src,
+                    int ndst, const box_t *dst_boxes, float *dst) {
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+    const box_t *my_src = src_boxes + (size_t) rank * nsrc;
+    const box_t *my_dst = dst_boxes + (size_t) rank * ndst;
+    box_t region;
+
+    // Count and pack the data for every destination rank
+    size_t total = 0;
+    for (int q = 0; q < nprocs; q++) {
+        size_t n = 0;
+        for (int s = 0; s < nsrc; s++) {
+            if (box_size(ndims, &my_src[s]) == 0) continue;
+            for (int t = 0; t < ndst; t++) {
+                const box_t *db = &dst_boxes[(size_t) q * ndst + t];
+                if (box_size(ndims, db) > 0 && box_intersect(ndims, &my_src[s], db, &region))
+                    n += box_size(ndims, &region);
+            }
+        }
+        if (n > INT_MAX || total > INT_MAX) {
+            printf("Rank %d: Error: exchange of %zu floats at offset %zu exceeds the MPI count range\n", rank, n, total);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        ex->sendcounts[q] = (int) n;
+        ex->sdispls[q] = (int) total;
+        total += n;
+    }
+    if (total > ex->sendbuf_size) {
+        free(ex->sendbuf);
+        ex->sendbuf = (float*) malloc(total * sizeof(float));
+        ex->sendbuf_size = total;
+    }
+    for (int q = 0; q < nprocs; q++) {
+        float *out = ex->sendbuf + ex->sdispls[q];
+        const float *in = src;
+        for (int s = 0; s < nsrc; s++) {
+            size_t n = box_size(ndims, &my_src[s]);
+            if (n == 0) continue;
+            for (int t = 0; t < ndst; t++) {
+                const box_t *db = &dst_boxes[(size_t) q * ndst + t];
+                if (box_size(ndims, db) > 0 && box_intersect(ndims, &my_src[s], db, &region)) {
+                    box_copy(ndims, &region, &my_src[s], in, &region, out);
+                    out += box_size(ndims, &region);
+                }
+            }
+            in += n;
+        }
+    }
+
+    // Count the data expected from every source rank
+    total = 0;
+    for (int r = 0; r < nprocs; r++) {
+        size_t n = 0;
+        for (int s = 0; s < nsrc; s++) {
+            const box_t *sb = &src_boxes[(size_t) r * nsrc + s];
+            if (box_size(ndims, sb) == 0) continue;
+            for (int t = 0; t < ndst; t++)
+                if (box_size(ndims, &my_dst[t]) > 0 && box_intersect(ndims, sb, &my_dst[t], &region))
+                    n += box_size(ndims, &region);
+        }
+        if (n > INT_MAX || total > INT_MAX) {
+            printf("Rank %d: Error: exchange of %zu floats at offset %zu exceeds the MPI count range\n", rank, n, total);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        ex->recvcounts[r] = (int) n;
+        ex->rdispls[r] = (int) total;
+        total += n;
+    }
+    if (total > ex->recvbuf_size) {
+        free(ex->recvbuf);
+        ex->recvbuf = (float*) malloc(total * sizeof(float));
+        ex->recvbuf_size = total;
+    }
+
+    MPI_Alltoallv(ex->sendbuf, ex->sendcounts, ex->sdispls, MPI_FLOAT,
+                  ex->recvbuf, ex->recvcounts, ex->rdispls, MPI_FLOAT, comm);
+
+    // Unpack into the target boxes in the order the sources packed them
+    size_t *dst_off = (size_t*) malloc(ndst * sizeof(size_t));
+    size_t off = 0;
+    for (int t = 0; t < ndst; t++) {
+        dst_off[t] = off;
+        off += box_size(ndims, &my_dst[t]);
+    }
+    for (int r = 0; r < nprocs; r++) {
+        const float *in = ex->recvbuf + ex->rdispls[r];
+        for (int s = 0; s < nsrc; s++) {
+            const box_t *sb = &src_boxes[(size_t) r * nsrc + s];
+            if (box_size(ndims, sb) == 0) continue;
+            for (int t = 0; t < ndst; t++) {
+                if (box_size(ndims, &my_dst[t]) > 0 && box_intersect(ndims, sb, &my_dst[t], &region)) {
+                    box_copy(ndims, &region, &region, in, &my_dst[t], dst + dst_off[t]);
+                    in += box_size(ndims, &region);
+                }
+            }
+        }
+    }
+    free(dst_off);
+}
+
+// Function to calculate the subdomain pieces of the process at (px, py)
+void compute_pieces(int px, int py, int nproc_x, int nproc_y, int halo,
+                    int lon_size, int lat_size, piece_t *pieces) {
+    int sub_lon = lon_size / nproc_x;
+    int sub_lat = lat_size / nproc_y;
+    
+    // Calculate base subdomain without halo first
+    int base_lon0 = px * sub_lon;
+    int base_lat0 = py * sub_lat;
+    int base_lon1 = px * sub_lon + sub_lon - 1;
+    int base_lat1 = py * sub_lat + sub_lat - 1;
+    
+    // Add halo, handling periodic boundaries. The periodic halo of the
+    // outermost columns wraps around the longitude axis and is read as
+    // separate pieces (left wrap for px == 0, right wrap for px == nproc_x-1)
+    if (halo > 0) {
+        if (px != 0) {
+            // Not left boundary: extend left
+            base_lon0 = (base_lon0 - halo < 0) ? 0 : base_lon0 - halo;
+        }
+        
+        if (px != nproc_x - 1) {
+            // Not right boundary: extend right
+            base_lon1 = (base_lon1 + halo >= lon_size) ? lon_size - 1 : base_lon1 + halo;
+        }
+        
+        // Add latitude halo (assuming no periodicity)
+        base_lat0 = (base_lat0 - halo < 0) ? 0 : base_lat0 - halo;
+        base_lat1 = (base_lat1 + halo >= lat_size) ? lat_size - 1 : base_lat1 + halo;
+    }
+
+    // Describe the subdomain as pieces: interior, left wrap, right wrap.
+    // Pieces a rank does not own keep a zero longitude count so that all
+    // ranks still issue the same sequence of collective calls
+    for (int p = 0; p < NPIECES; p++) {
+        pieces[p].lat0 = base_lat0;
+        pieces[p].nlat = base_lat1 - base_lat0 + 1;
+        pieces[p].lon0 = 0;
+        pieces[p].nlon = 0;
+    }
+    pieces[PIECE_INTERIOR].lon0 = base_lon0;
+    pieces[PIECE_INTERIOR].nlon = base_lon1 - base_lon0 + 1;
+    if (halo > 0 && px == 0) {
+        pieces[PIECE_LEFT_WRAP].lon0 = lon_size - halo;
+        pieces[PIECE_LEFT_WRAP].nlon = halo;
+    }
+    if (halo > 0 && px == nproc_x - 1) {
+        pieces[PIECE_RIGHT_WRAP].lon0 = 0;
+        pieces[PIECE_RIGHT_WRAP].nlon = halo;
+    }
+}
+
+// Function to read all pieces of one variable into consecutive parts of buffer.
+// In collective mode every rank takes part in every nc_get_vara_float call,
+// with a zero count for pieces it does not own, so that ranks without a
+// periodic halo do not leave the other ranks waiting in the collective.
+// netCDF has no multi-hyperslab read, so this is one collective per piece
+int read_pieces(int ncid, int varid, int ndims, int lat_idx, int lon_idx,
+                const piece_t *pieces, int npieces, int use_independent,
+                size_t *start, size_t *count, float *buffer) {
+    float *dst = buffer;
+    for (int p = 0; p < npieces; p++) {
+        if (pieces[p].nlon == 0 && use_independent) continue;
+        start[lat_idx] = pieces[p].lat0;
+        start[lon_idx] = pieces[p].lon0;
+        count[lat_idx] = pieces[p].nlat;
+        count[lon_idx] = pieces[p].nlon;
+        int retval = nc_get_vara_float(ncid, varid, start, count, dst);
+        if (retval != NC_NOERR)
+            return retval;
+        size_t n = 1;
+        for (int d = 0; d < ndims; d++)
+            n *= count[d];
+        dst += n;
+    }
+    return NC_NOERR;
+}
+
+// Function to convert a piece into a box covering all other dimensions fully
+void piece_box(const piece_t *piece, int ndims, const size_t *dimlen,
+               int lat_idx, int lon_idx, box_t *box) {
+    for (int d = 0; d < ndims; d++) {
+        box->start[d] = 0;
+        box->count[d] = dimlen[d];
+    }
+    box->start[lat_idx] = piece->lat0;
+    box->count[lat_idx] = piece->nlat;
+    box->start[lon_idx] = piece->lon0;
+    box->count[lon_idx] = piece->nlon;
+}
+
+// Function to compute the piece boxes of all ranks of a nproc_x x nproc_y grid
+void compute_all_boxes(int nproc_x, int nproc_y, int halo, int ndims, const size_t *dimlen,
+                       int lat_idx, int lon_idx, int npieces, box_t *all_boxes) {
+    for (int r = 0; r < nproc_x * nproc_y; r++) {
+        piece_t rpieces[NPIECES];
+        compute_pieces(r % nproc_x, r / nproc_x, nproc_x, nproc_y, halo,
+                       dimlen[lon_idx], dimlen[lat_idx], rpieces);
+        for (int p = 0; p < npieces; p++)
+            piece_box(&rpieces[p], ndims, dimlen, lat_idx, lon_idx, &all_boxes[(size_t) r * npieces + p]);
+    }
+}
+
+// Function to compute the box of process (px, py) in a decomposition without
+// halo that covers the whole lat/lon plane, spreading the remainder evenly
+void cover_box(int px, int py, int nx, int ny, int ndims, const size_t *dimlen,
+               int lat_idx, int lon_idx, box_t *box) {
+    for (int d = 0; d < ndims; d++) {
+        box->start[d] = 0;
+        box->count[d] = dimlen[d];
+    }
+    box->start[lon_idx] = px * dimlen[lon_idx] / nx;
+    box->count[lon_idx] = (px + 1) * dimlen[lon_idx] / nx - box->start[lon_idx];
+    box->start[lat_idx] = py * dimlen[lat_idx] / ny;
+    box->count[lat_idx] = (py + 1) * dimlen[lat_idx] / ny - box->start[lat_idx];
+}
+
+// Function to prepend a slot dimension to a box. Boxes in different slots
+// never intersect, which lets one exchange fill several buffers at once
+void slot_box(int slot, int nslots, int ndims, const box_t *box, box_t *out) {
+    for (int d = ndims; d > 0; d--) {
+        out->start[d] = box->start[d - 1];
+        out->count[d] = box->count[d - 1];
+    }
+    out->start[0] = slot;
+    out->count[0] = nslots;
+}
+
+// Function to compute the greatest common divisor for stripe alignment
+size_t gcd_size(size_t a, size_t b) {
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+// Function to compute the block of rows [row0, row0 + nrows) along split_dim,
+// clipped to the variable, at the linear index outer of the slower dimensions
+void two_phase_block(int ndims, const size_t *dimlen, int split_dim, size_t outer,
+                     size_t row0, size_t nrows, box_t *box) {
+    for (int d = ndims - 1; d >= 0; d--) {
+        if (d > split_dim) {
+            box->start[d] = 0;
+            box->count[d] = dimlen[d];
+        } else if (d == split_dim) {
+            box->start[d] = row0 < dimlen[d] ? row0 : dimlen[d];
+            box->count[d] = row0 >= dimlen[d] ? 0 : (row0 + nrows > dimlen[d]) ? dimlen[d] - row0 : nrows;
+        } else {
+            box->start[d] = outer % dimlen[d];
+            box->count[d] = 1;
+            outer /= dimlen[d];
+        }
+    }
+}
+
+// Function to compute the number of rows of inner bytes each from byte
+// position pos to the first row boundary that is closest after a multiple of
+// align. Row boundaries keep pos modulo gcd(inner, align), so the boundary
+// found starts pos % gcd bytes into a stripe (exactly on it if that is 0)
+static size_t rows_to_boundary(size_t pos, size_t inner, size_t align) {
+    size_t g = gcd_size(inner, align);
+    size_t gap = (align - pos % align + pos % g) % align;
+    // Solve r * inner = gap (mod align) with the inverse of inner / g
+    long long m = (long long) (align / g), a = (long long) ((inner / g) % (align / g));
+    long long x0 = 0, x1 = 1, r0 = m, r1 = a;
+    while (r1 != 0) {
+        long long q = r0 / r1, t = r0 - q * r1;
+        r0 = r1;
+        r1 = t;
+        t = x0 - q * x1;
+        x0 = x1;
+        x1 = t;
+    }
+    unsigned long long inv = (unsigned long long) ((x0 % m + m) % m);
+    return (size_t) ((unsigned long long) (gap / g) % m * inv % m);
+}
+
+// Function to set up two-phase I/O for the subdomains of b, one rank of comm
+// per subdomain. naggr aggregators (0 for one per node) are placed by
+// placement: spread evenly over the ranks, packed onto the first ranks, or
+// one per node (rank 0 of each node). Blocks hold at most cb_buffer bytes and
+// contiguous variables are aligned to align bytes (0 to disable)
+void two_phase_init(two_phase_t *tp, const bench_t *b, MPI_Comm comm, int naggr, const char *placement,
+                    size_t cb_buffer, size_t align) {
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+    if (b->ndims > MAX_DIMS || nprocs != b->nproc_x * b->nproc_y) {
+        if (rank == 0)
+            printf("Error: two-phase I/O supports at most %d dimensions and needs one rank per subdomain\n",
+                   MAX_DIMS);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    int by_node = strcmp(placement, "node") == 0;
+    if (!by_node && strcmp(placement, "packed") != 0 && strcmp(placement, "spread") != 0) {
+        if (rank == 0)
+            printf("Error: unknown aggregator placement %s\n", placement);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Node-local rank 0 marks one aggregator candidate per node
+    MPI_Comm node_comm;
+    int node_rank, nnodes = 0;
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+    MPI_Comm_rank(node_comm, &node_rank);
+    int *node_leader = (int*) malloc(nprocs * sizeof(int));
+    int is_leader = (node_rank == 0);
+    MPI_Allgather(&is_leader, 1, MPI_INT, node_leader, 1, MPI_INT, comm);
+    MPI_Comm_free(&node_comm);
+    for (int r = 0; r < nprocs; r++)
+        nnodes += node_leader[r];
+
+    if (by_node || naggr <= 0)
+        naggr = nnodes;
+    if (naggr > nprocs)
+        naggr = nprocs;
+    memset(tp, 0, sizeof(*tp));
+    tp->aggr_ranks = (int*) malloc(naggr * sizeof(int));
+    if (by_node) {
+        for (int r = 0, a = 0; r < nprocs; r++)
+            if (node_leader[r]) tp->aggr_ranks[a++] = r;
+    } else if (strcmp(placement, "packed") == 0) {
+        for (int a = 0; a < naggr; a++)
+            tp->aggr_ranks[a] = a;
+    } else {
+        for (int a = 0; a < naggr; a++)
+            tp->aggr_ranks[a] = (int) ((long) a * nprocs / naggr);
+    }
+    free(node_leader);
+
+    tp->ndims = b->ndims;
+    tp->comm = comm;
+    tp->nprocs = nprocs;
+    tp->rank = rank;
+    tp->naggr = naggr;
+    tp->my_aggr = -1;
+    for (int a = 0; a < naggr; a++)
+        if (tp->aggr_ranks[a] == rank) tp->my_aggr = a;
+    tp->cb_buffer = cb_buffer;
+    tp->align = align;
+    tp->npieces = b->npieces;
+    tp->all_boxes = (box_t*) malloc((size_t) nprocs * b->npieces * sizeof(box_t));
+    compute_all_boxes(b->nproc_x, b->nproc_y, b->halo, b->ndims, b->dimlen, b->lat_idx, b->lon_idx, b->npieces,
+                      tp->all_boxes);
+    tp->block_boxes = (box_t*) malloc(nprocs * sizeof(box_t));
+    if (tp->my_aggr >= 0)
+        tp->blockbuf = (float*) malloc(cb_buffer > sizeof(float) ? cb_buffer : sizeof(float));
+    exchange_init(&tp->ex, nprocs);
+}
+
+// Function to free the buffers of two_phase_init
+void two_phase_free(two_phase_t *tp) {
+    free(tp->aggr_ranks);
+    free(tp->all_boxes);
+    free(tp->block_boxes);
+    free(tp->blockbuf);
+    free(tp->offsets);
+    exchange_free(&tp->ex);
+}
+
+// Function to look up the file offsets of the variables of a netCDF-4 file
+// through HDF5 (H5Dget_offset) on rank 0 of comm and share them. Chunked
+// variables, and all variables of files HDF5 cannot open (classic netCDF),
+// get offset 0, so their blocks stay aligned relative to the variable
+void two_phase_offsets(two_phase_t *tp, const char *path, int nvars,
+                       char (*varnames)[NC_MAX_NAME + 1], MPI_Comm comm) {
+    int crank;
+    MPI_Comm_rank(comm, &crank);
+    if (tp->offsets == NULL)
+        tp->offsets = (unsigned long long*) malloc(nvars * sizeof(unsigned long long));
+    if (crank == 0) {
+        memset(tp->offsets, 0, nvars * sizeof(unsigned long long));
+        hid_t file = -1;
+        H5E_BEGIN_TRY {
+            if (H5Fis_hdf5(path) > 0)
+                file = H5Fopen(path, H5F_ACC_RDONLY, H5P_DEFAULT);
+        } H5E_END_TRY;
+        for (int varid = 0; file >= 0 && varid < nvars; varid++) {
+            hid_t dset;
+            H5E_BEGIN_TRY {
+                dset = H5Dopen2(file, varnames[varid], H5P_DEFAULT);
+            } H5E_END_TRY;
+            if (dset < 0) continue;
+            haddr_t addr = H5Dget_offset(dset);
+            if (addr != HADDR_UNDEF)
+                tp->offsets[varid] = addr;
+            H5Dclose(dset);
+        }
+        if (file >= 0)
+            H5Fclose(file);
+    }
+    MPI_Bcast(tp->offsets, nvars, MPI_UNSIGNED_LONG_LONG, 0, comm);
+}
+
+// Function to read one variable with two-phase I/O into the piece layout of buffer
+int read_var_two_phase(two_phase_t *tp, int ncid, int varid, const size_t *dimlen,
+                       float *buffer) {
+    int ndims = tp->ndims;
+
+    // Choose the slowest dimension whose faster dimensions still fit into one block
+    int split_dim = 0;
+    size_t inner = sizeof(float);
+    for (int d = 0; d < ndims; d++)
+        inner *= dimlen[d];
+    for (split_dim = 0; split_dim < ndims - 1; split_dim++) {
+        inner /= dimlen[split_dim];
+        if (inner <= tp->cb_buffer) break;
+    }
+    if (split_dim == ndims - 1)
+        inner = sizeof(float);
+    size_t rows = tp->cb_buffer / inner;
+    if (rows < 1) rows = 1;
+    if (rows > dimlen[split_dim]) rows = dimlen[split_dim];
+
+    // Align block boundaries to the chunk shape, or for contiguous storage
+    // to the stripe size. With the file offset of the variable known (see
+    // two_phase_offsets), every run along split_dim starts with a head block
+    // up to the first stripe boundary in the file, else blocks are aligned
+    // relative to the start of the variable
+    int storage;
+    size_t chunks[MAX_DIMS];
+    int retval = nc_inq_var_chunking(ncid, varid, &storage, chunks);
+    if (retval != NC_NOERR)
+        return retval;
+    size_t unit = 1;
+    if (storage == NC_CHUNKED)
+        unit = chunks[split_dim];
+    else if (tp->align > 0)
+        unit = tp->align / gcd_size(tp->align, inner);
+    if (rows >= unit)
+        rows = rows / unit * unit;
+    size_t offset = 0, run = dimlen[split_dim] * inner;
+    if (storage != NC_CHUNKED && tp->offsets != NULL)
+        offset = tp->offsets[varid];
+    int heads = storage != NC_CHUNKED && tp->align > 0 && rows % unit == 0
+                && (offset % tp->align != 0 || (split_dim > 0 && run % tp->align != 0));
+
+    size_t nsplit = (dimlen[split_dim] + rows - 1) / rows + (heads ? 1 : 0);
+    size_t nblocks = nsplit;
+    for (int d = 0; d < split_dim; d++)
+        nblocks *= dimlen[d];
+    size_t nrounds = (nblocks + tp->naggr - 1) / tp->naggr;
+
+    for (size_t r = 0; r < nrounds; r++) {
+        // Blocks of all aggregators active in this round
+        memset(tp->block_boxes, 0, tp->nprocs * sizeof(box_t));
+        for (int a = 0; a < tp->naggr; a++) {
+            size_t b = r * tp->naggr + a;
+            if (b >= nblocks) continue;
+            size_t outer = b / nsplit, j = b % nsplit, row0 = j * rows, nrows = rows;
+            if (heads) {
+                size_t head = rows_to_boundary(offset + outer * run, inner, tp->align);
+                row0 = (j == 0) ? 0 : head + (j - 1) * rows;
+                nrows = (j == 0) ? head : rows;
+            }
+            two_phase_block(ndims, dimlen, split_dim, outer, row0, nrows, &tp->block_boxes[tp->aggr_ranks[a]]);
+        }
+
+        // Phase 1: aggregators read their block of this round
+        const box_t *block = &tp->block_boxes[tp->rank];
+        if (box_size(ndims, block) > 0) {
+            retval = nc_get_vara_float(ncid, varid, block->start, block->count, tp->blockbuf);
+            if (retval != NC_NOERR)
+                return retval;
+        }
+
+        // Phase 2: ship the parts of the blocks to the owners of the pieces
+        exchange_boxes(&tp->ex, tp->comm, ndims, 1, tp->block_boxes, tp->blockbuf,
+                       tp->npieces, tp->all_boxes, buffer);
+    }
+    return NC_NOERR;
+}
+
+// Function to set up read throttling over the ranks of comm
+void throttle_init(throttle_t *th, int k, int method, MPI_Comm comm) {
+    th->k = k;
+    th->method = method;
+    th->comm = comm;
+    th->win = MPI_WIN_NULL;
+    MPI_Comm_rank(comm, &th->crank);
+    MPI_Comm_size(comm, &th->csize);
+    if (k > 0 && method == THROTTLE_RMA) {
+        MPI_Aint size = (th->crank == 0) ? 2 * sizeof(long) : 0;
+        MPI_Win_allocate(size, sizeof(long), MPI_INFO_NULL, comm, &th->counters, &th->win);
+        if (th->crank == 0)
+            th->counters[0] = th->counters[1] = 0;
+        MPI_Barrier(comm);
+        MPI_Win_lock_all(0, th->win);
+    }
+}
+
+// Function to wait for a read token. Returns the time spent waiting
+double throttle_acquire(throttle_t *th, int tag) {
+    if (th->k <= 0)
+        return 0.0;
+    double t0 = get_time_sec();
+    if (th->method == THROTTLE_RMA) {
+        long one = 1, ticket, done, dummy = 0;
+        MPI_Fetch_and_op(&one, &ticket, MPI_LONG, 0, 0, MPI_SUM, th->win);
+        MPI_Win_flush(0, th->win);
+        for (;;) {
+            MPI_Fetch_and_op(&dummy, &done, MPI_LONG, 0, 1, MPI_NO_OP, th->win);
+            MPI_Win_flush(0, th->win);
+            if (ticket < done + th->k) break;
+            usleep(50);
+        }
+    } else if (th->crank >= th->k) {
+        MPI_Recv(NULL, 0, MPI_BYTE, th->crank - th->k, tag, th->comm, MPI_STATUS_IGNORE);
+    }
+    return get_time_sec() - t0;
+}
+
+// Function to return a read token
+void throttle_release(throttle_t *th, int tag) {
+    if (th->k <= 0)
+        return;
+    if (th->method == THROTTLE_RMA) {
+        long one = 1, old;
+        MPI_Fetch_and_op(&one, &old, MPI_LONG, 0, 1, MPI_SUM, th->win);
+        MPI_Win_flush(0, th->win);
+    } else if (th->crank + th->k < th->csize) {
+        MPI_Send(NULL, 0, MPI_BYTE, th->crank + th->k, tag, th->comm);
+    }
+}
+
+// Function to free the throttling resources
+void throttle_free(throttle_t *th) {
+    if (th->win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(th->win);
+        MPI_Win_free(&th->win);
+    }
+}
+
+// Function to open a file in parallel mode on comm and set the access mode of all data variables
+int open_par(const bench_t *b, const char *path, MPI_Comm comm, int use_independent) {
+    int ncid;
+    int retval = nc_open_par(path, NC_NOWRITE, comm, MPI_INFO_NULL, &ncid);
+    if (retval != NC_NOERR) {
+        printf("Rank %d: Error opening file %s: %s\n", b->rank, path, nc_strerror(retval));
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+        if (b->is_dimvar[varid]) continue;
+        retval = nc_var_par_access(ncid, varid, use_independent ? NC_INDEPENDENT : NC_COLLECTIVE);
+        if (retval != NC_NOERR) {
+            printf("Rank %d: Error setting %s access for var %d: %s\n",
+                   b->rank, use_independent ? "independent" : "collective", varid, nc_strerror(retval));
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    return ncid;
+}
+
+// Function to open a file with plain serial nc_open on each rank, bypassing
+// MPI-IO. A non-zero readahead is passed as buffer size hint to nc__open,
+// which sets the read buffer size for classic and 64-bit offset files
+int open_serial(const bench_t *b, const char *path, size_t readahead) {
+    int ncid;
+    size_t hint = (readahead > 0) ? readahead : NC_SIZEHINT_DEFAULT;
+    int retval = nc__open(path, NC_NOWRITE, &hint, &ncid);
+    if (retval != NC_NOERR) {
+        printf("Rank %d: Error opening file %s: %s\n", b->rank, path, nc_strerror(retval));
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    return ncid;
+}
+
+// Function to calculate the number of floats read for a set of pieces
+size_t pieces_size(const bench_t *b, const piece_t *pieces) {
+    size_t n = 0;
+    for (int p = 0; p < b->npieces; p++) {
+        size_t np = (size_t) pieces[p].nlat * pieces[p].nlon;
+        for (int d = 0; d < b->ndims; d++)
+            if (d != b->lat_idx && d != b->lon_idx) np *= b->dimlen[d];
+        n += np;
+    }
+    return n;
+}
+
+// File-parallel mode. MPI_COMM_WORLD is split into groups of consecutive ranks
+// that read different files at the same time, each group with its own
+// decomposition covering the whole domain. Unless disabled, each variable is
+// then shipped to the owners of the global decomposition in one exchange for
+// all groups. Returns the total wall time
+double run_file_parallel(const bench_t *b, int ngroups, int redistribute, double *file_times) {
+    int gsize = b->nprocs / ngroups;
+    int group = b->rank / gsize;
+    MPI_Comm group_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, group, b->rank, &group_comm);
+
+    // Decomposition of each group, longitude split at least as often as latitude
+    int dims[2] = {0, 0};
+    MPI_Dims_create(gsize, 2, dims);
+    int gx = dims[0], gy = dims[1];
+    if (b->rank == 0)
+        printf("File groups: %d (%d ranks each, %dx%d group grid, redistribute=%s)\n",
+               ngroups, gsize, gx, gy, redistribute ? "yes" : "no");
+
+    // Read boxes of all ranks with a slot dimension per group, and the pieces
+    // of the global decomposition with one slot per group
+    int ndims = b->ndims;
+    box_t *cover = (box_t*) malloc(b->nprocs * sizeof(box_t));
+    box_t *src_boxes = (box_t*) malloc(b->nprocs * sizeof(box_t));
+    for (int r = 0; r < b->nprocs; r++) {
+        box_t box;
+        int gr = r % gsize;
+        cover_box(gr % gx, gr / gx, gx, gy, ndims, b->dimlen, b->lat_idx, b->lon_idx, &box);
+        slot_box(r / gsize, 1, ndims, &box, &cover[r]);
+    }
+    int ndst = ngroups * b->npieces;
+    box_t *dst_boxes = (box_t*) malloc((size_t) b->nprocs * ndst * sizeof(box_t));
+    box_t *pieces = (box_t*) malloc((size_t) b->nprocs * b->npieces * sizeof(box_t));
+    compute_all_boxes(b->nproc_x, b->nproc_y, b->halo, ndims, b->dimlen, b->lat_idx, b->lon_idx,
+                      b->npieces, pieces);
+    for (int r = 0; r < b->nprocs; r++)
+        for (int g = 0; g < ngroups; g++)
+            for (int p = 0; p < b->npieces; p++)
+                slot_box(g, 1, ndims, &pieces[(size_t) r * b->npieces + p],
+                         &dst_boxes[(size_t) r * ndst + g * b->npieces + p]);
+    size_t slot_size = 0;
+    for (int p = 0; p < b->npieces; p++)
+        slot_size += box_size(ndims, &pieces[(size_t) b->rank * b->npieces + p]);
+
+    float *readbuf = (float*) malloc(box_size(ndims + 1, &cover[b->rank]) * sizeof(float));
+    float *recvbuf = redistribute ? (float*) malloc(ngroups * slot_size * sizeof(float)) : NULL;
+    exchange_t ex;
+    exchange_init(&ex, b->nprocs);
+
+    for (int f = 0; f < b->nfiles; f++)
+        file_times[f] = 0.0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = get_time_sec();
+    int nrounds = (b->nfiles + ngroups - 1) / ngroups;
+    for (int round = 0; round < nrounds; round++) {
+        int f = round * ngroups + group;
+        int active = f < b->nfiles;
+        for (int r = 0; r < b->nprocs; r++) {
+            src_boxes[r] = cover[r];
+            if (round * ngroups + r / gsize >= b->nfiles)
+                src_boxes[r].count[0] = 0;
+        }
+
+        double file_start = get_time_sec();
+        int ncid = -1;
+        if (active)
+            ncid = open_par(b, b->file_list[f], group_comm, b->use_independent);
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            if (active) {
+                const box_t *box = &cover[b->rank];
+                int retval = nc_get_vara_float(ncid, varid, box->start + 1, box->count + 1, readbuf);
+                if (retval != NC_NOERR) {
+                    printf("Rank %d: Error reading var %d of file %s: %s\n", b->rank, varid, b->file_list[f], nc_strerror(retval));
+                    safe_abort(MPI_COMM_WORLD, 1);
+                }
+            }
+            if (redistribute)
+                exchange_boxes(&ex, MPI_COMM_WORLD, ndims + 1, 1, src_boxes, readbuf,
+                               ndst, dst_boxes, recvbuf);
+            readbuf[0] *= 3.4;
+        }
+        if (active) {
+            nc_close(ncid);
+            MPI_Barrier(group_comm);
+            file_times[f] = get_time_sec() - file_start;
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_time = get_time_sec() - total_start;
+
+    exchange_free(&ex);
+    free(readbuf);
+    free(recvbuf);
+    free(cover);
+    free(src_boxes);
+    free(dst_boxes);
+    free(pieces);
+    MPI_Comm_free(&group_comm);
+    return total_time;
+}
+
+// Function to read a whole file into memory with large sequential reads.
+// Returns the number of bytes read
+size_t read_whole_file(const char *path, size_t size, size_t read_size, char *mem) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Error opening file %s for reading\n", path);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    size_t done = 0;
+    while (done < size) {
+        size_t n = (size - done < read_size) ? size - done : read_size;
+        ssize_t got = pread(fd, mem + done, n, done);
+        if (got <= 0) {
+            printf("Error reading file %s at offset %zu\n", path, done);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        done += got;
+    }
+    close(fd);
+    return done;
+}
+
+// Function to broadcast a large buffer in pieces that fit into an int count
+void bcast_large(char *mem, size_t size, int root, MPI_Comm comm) {
+    const size_t max_count = (size_t) 1 << 30;
+    for (size_t off = 0; off < size; off += max_count) {
+        size_t n = (size - off < max_count) ? size - off : max_count;
+        MPI_Bcast(mem + off, (int) n, MPI_BYTE, root, comm);
+    }
+}
+
+// Read-once-and-broadcast mode over the bcast engine, with one reader per
+// file round-robin over the ranks of each node (node_scope) or of all ranks.
+// Per-file phase times (maximum over ranks of reading, distributing and
+// extracting) are returned in phase_times
+void run_bcast(const bench_t *b, int node_scope, int use_shm, size_t read_size,
+               double *file_times, double *phase_times) {
+    ddr_options_t opt;
+    ddr_options_init(&opt);
+    if (node_scope)
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &opt.bcast_comm);
+    opt.bcast_shm = use_shm;
+    opt.read_size = read_size;
+    ddr_reader_t r;
+    ddr_reader_init(&r, ddr_find_engine("bcast"), b, MPI_COMM_WORLD, &opt);
+
+    for (int f = 0; f < b->nfiles; f++) {
+        double t0 = get_time_sec();
+        ddr_open(&r, b->file_list[f]);
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            int retval = ddr_read(&r, varid, b->buffer);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error reading subdomain for var %d from memory: %s\n", b->rank, varid, nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            b->buffer[0] *= 3.4;
+        }
+        ddr_close(&r);
+        MPI_Barrier(MPI_COMM_WORLD);
+        file_times[f] = get_time_sec() - t0;
+        double max_phases[3];
+        MPI_Allreduce(r.stats.phase_times, max_phases, 3, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+        for (int i = 0; i < 3; i++)
+            phase_times[i] += max_phases[i] / b->nfiles;
+    }
+
+    ddr_reader_free(&r);
+    if (node_scope)
+        MPI_Comm_free(&opt.bcast_comm);
+}
+
+// Function to read all pieces of one dataset through the HDF5 API directly.
+// As with read_pieces, all ranks take part in every read in collective mode
+herr_t read_pieces_hdf5(const bench_t *b, hid_t dset, hid_t dxpl, float *buffer) {
+    float *dst = buffer;
+    for (int p = 0; p < b->npieces; p++) {
+        if (b->pieces[p].nlon == 0 && b->use_independent) continue;
+        box_t box;
+        hsize_t start[MAX_DIMS], count[MAX_DIMS];
+        piece_box(&b->pieces[p], b->ndims, b->dimlen, b->lat_idx, b->lon_idx, &box);
+        for (int d = 0; d < b->ndims; d++) {
+            start[d] = box.start[d];
+            count[d] = box.count[d];
+        }
+        size_t n = box_size(b->ndims, &box);
+        hid_t filespace = H5Dget_space(dset);
+        hid_t memspace = H5Screate_simple(b->ndims, count, NULL);
+        if (n > 0) {
+            H5Sselect_hyperslab(filespace, H5S_SELECT_SET, start, NULL, count, NULL);
+        } else {
+            H5Sselect_none(filespace);
+            H5Sselect_none(memspace);
+        }
+        herr_t status = H5Dread(dset, H5T_NATIVE_FLOAT, memspace, filespace, dxpl, dst);
+        H5Sclose(memspace);
+        H5Sclose(filespace);
+        if (status < 0)
+            return status;
+        dst += n;
+    }
+    return 0;
+}
+
+// Function to read all pieces of one dataset like read_pieces_hdf5, but
+// only from the chunks that the chunk index of the dataset lists as
+// allocated. The parts of the pieces in unallocated chunks are set to the
+// fill value in memory, without a library read; *skipped receives their
+// bytes. Datasets that are contiguous or have all chunks allocated, as found
+// by H5Dget_num_chunks, take the plain path. Each chunk intersecting a piece
+// is looked up by its coordinates, since the lookup by index walks the
+// index from its start for every chunk
+herr_t read_pieces_sparse(const bench_t *b, hid_t dset, hid_t dxpl, float *buffer, size_t *skipped) {
+    *skipped = 0;
+#if !H5_VERSION_GE(1, 10, 5)
+    // No chunk index queries before HDF5 1.10.5
+    return read_pieces_hdf5(b, dset, dxpl, buffer);
+#else
+    int nd = b->ndims;
+    hid_t dcpl = H5Dget_create_plist(dset);
+    hsize_t chunk[MAX_DIMS];
+    int chunked = H5Pget_layout(dcpl) == H5D_CHUNKED && H5Pget_chunk(dcpl, MAX_DIMS, chunk) == nd;
+    H5D_fill_value_t defined;
+    float fill = 0.0f;
+    if (H5Pfill_value_defined(dcpl, &defined) >= 0 && defined != H5D_FILL_VALUE_UNDEFINED)
+        H5Pget_fill_value(dcpl, H5T_NATIVE_FLOAT, &fill);
+    H5Pclose(dcpl);
+    hid_t filespace = H5Dget_space(dset);
+    hsize_t nalloc = 0, nchunks = 1;
+    for (int d = 0; chunked && d < nd; d++)
+        nchunks *= (b->dimlen[d] + chunk[d] - 1) / chunk[d];
+    if (!chunked || H5Dget_num_chunks(dset, filespace, &nalloc) < 0 || nalloc >= nchunks) {
+        H5Sclose(filespace);
+        return read_pieces_hdf5(b, dset, dxpl, buffer);
+    }
+
+    float *dst = buffer;
+    for (int p = 0; p < b->npieces; p++) {
+        if (b->pieces[p].nlon == 0 && b->use_independent) continue;
+        box_t box;
+        hsize_t count[MAX_DIMS];
+        piece_box(&b->pieces[p], nd, b->dimlen, b->lat_idx, b->lon_idx, &box);
+        for (int d = 0; d < nd; d++)
+            count[d] = box.count[d];
+        size_t n = box_size(nd, &box);
+        hid_t memspace = H5Screate_simple(nd, count, NULL);
+        H5Sselect_none(filespace);
+        H5Sselect_none(memspace);
+        if (nalloc == 0) {
+            box_fill(nd, &box, &box, dst, fill);
+            *skipped += n * sizeof(float);
+        }
+        // Read the parts of the piece in allocated chunks and fill the
+        // others. Independent reads take each part as a simple hyperslab,
+        // collective reads select all parts in file and memory, in the same
+        // order, for one read per piece on all ranks
+        size_t idx[MAX_DIMS], lo[MAX_DIMS], hi[MAX_DIMS];
+        for (int d = 0; nalloc > 0 && n > 0 && d < nd; d++) {
+            lo[d] = idx[d] = box.start[d] / chunk[d];
+            hi[d] = (box.start[d] + box.count[d] - 1) / chunk[d];
+        }
+        for (int more = nalloc > 0 && n > 0; more;) {
+            box_t cbox, region;
+            hsize_t offset[MAX_DIMS], fstart[MAX_DIMS], mstart[MAX_DIMS], rcount[MAX_DIMS];
+            for (int d = 0; d < nd; d++) {
+                cbox.start[d] = idx[d] * chunk[d];
+                cbox.count[d] = chunk[d];
+                offset[d] = cbox.start[d];
+            }
+            box_intersect(nd, &cbox, &box, &region);
+            haddr_t addr = HADDR_UNDEF;
+            hsize_t size = 0;
+            H5Dget_chunk_info_by_coord(dset, offset, NULL, &addr, &size);
+            if (addr != HADDR_UNDEF && size > 0) {
+                for (int d = 0; d < nd; d++) {
+                    fstart[d] = region.start[d];
+                    mstart[d] = region.start[d] - box.start[d];
+                    rcount[d] = region.count[d];
+                }
+                H5S_seloper_t op = b->use_independent ? H5S_SELECT_SET : H5S_SELECT_OR;
+                H5Sselect_hyperslab(filespace, op, fstart, NULL, rcount, NULL);
+                H5Sselect_hyperslab(memspace, op, mstart, NULL, rcount, NULL);
+                if (b->use_independent && H5Dread(dset, H5T_NATIVE_FLOAT, memspace, filespace, dxpl, dst) < 0) {
+                    H5Sclose(memspace);
+                    H5Sclose(filespace);
+                    return -1;
+                }
+            } else {
+                box_fill(nd, &region, &box, dst, fill);
+                *skipped += box_size(nd, &region) * sizeof(float);
+            }
+            int d = nd - 1;
+            while (d >= 0 && ++idx[d] > hi[d]) {
+                idx[d] = lo[d];
+                d--;
+            }
+            more = d >= 0;
+        }
+        herr_t status = 0;
+        if (!b->use_independent)
+            status = H5Dread(dset, H5T_NATIVE_FLOAT, memspace, filespace, dxpl, dst);
+        H5Sclose(memspace);
+        if (status < 0) {
+            H5Sclose(filespace);
+            return status;
+        }
+        dst += n;
+    }
+    H5Sclose(filespace);
+    return 0;
+#endif
+}
+
+// Function to open and read all files once with the hdf5 engine, with the
+// sparse or the plain read path. Adds the read time of each data variable to
+// var_times[f * nvars + ivar] and the skipped bytes to skipped, if not NULL
+static void hdf5_pass(const bench_t *b, int coll_metadata, int sparse, double *file_times,
+                      double *open_times, double *first_read_times, double *var_times, double *skipped) {
+    ddr_options_t opt;
+    ddr_options_init(&opt);
+    opt.coll_metadata = coll_metadata;
+    opt.sparse = sparse;
+    ddr_reader_t r;
+    ddr_reader_init(&r, ddr_find_engine("hdf5"), b, MPI_COMM_WORLD, &opt);
+
+    for (int f = 0; f < b->nfiles; f++) {
+        double open_start = get_time_sec();
+        ddr_open(&r, b->file_list[f]);
+        open_times[f] = get_time_sec() - open_start;
+
+        double file_start = get_time_sec();
+        int first = 1, ivar = 0;
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            double var_start = get_time_sec();
+            size_t skipped_before = r.stats.skipped;
+            if (ddr_read(&r, varid, b->buffer) != NC_NOERR) {
+                printf("Rank %d: Error reading subdomain for dataset %s\n", b->rank, b->varnames[varid]);
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            b->buffer[0] *= 3.4;
+            if (var_times != NULL)
+                var_times[(size_t) f * b->nvars + ivar] += get_time_sec() - var_start;
+            if (skipped != NULL)
+                skipped[(size_t) f * b->nvars + ivar] += (double) (r.stats.skipped - skipped_before);
+            ivar++;
+            if (first) {
+                first_read_times[f] = get_time_sec() - file_start;
+                first = 0;
+            }
+        }
+        ddr_close(&r);
+        MPI_Barrier(MPI_COMM_WORLD);
+        file_times[f] = get_time_sec() - file_start;
+    }
+
+    ddr_reader_free(&r);
+}
+
+// Direct HDF5 mode for netCDF-4 inputs over the hdf5 engine. The open time
+// includes opening all datasets.
+// With sparse reads, unallocated chunks are skipped (read_pieces_sparse) and
+// all files are read a second time with the plain path for comparison.
+// sparse_times receives the read time of each variable of each file with
+// both paths, skipped the bytes skipped; both may be NULL without sparse reads
+void run_hdf5(const bench_t *b, int coll_metadata, int sparse, double *file_times,
+              double *open_times, double *first_read_times, double *sparse_times, double *skipped) {
+#ifndef H5_HAVE_PARALLEL
+    if (b->rank == 0)
+        printf("Warning: HDF5 without parallel support, every rank opens the files serially\n");
+#endif
+    hdf5_pass(b, coll_metadata, sparse, file_times, open_times, first_read_times, sparse_times, skipped);
+    if (sparse) {
+        double *times = (double*) malloc((size_t) 3 * b->nfiles * sizeof(double));
+        hdf5_pass(b, coll_metadata, 0, times, times + b->nfiles, times + 2 * b->nfiles,
+                  sparse_times + (size_t) b->nfiles * b->nvars, NULL);
+        free(times);
+    }
+}
+
+// Function to compare doubles for qsort
+int compare_double(const void *a, const void *b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+// Function to get a percentile from sorted values
+double percentile(const double *sorted, size_t n, double p) {
+    if (n == 0)
+        return 0.0;
+    size_t i = (size_t) (p / 100.0 * (n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+// Metadata-only mode. The ranks are split into groups of comm_size ranks that
+// repeatedly run nc_open_par, nc_inq, nc_var_par_access for all variables and
+// nc_close over the file list without reading data. With a stagger, group g
+// starts each open g * stagger_us microseconds after a common barrier. Rank 0
+// reports opens/s and percentiles of the per-rank open cycle latency
+void run_metadata(const bench_t *b, int comm_size, int repeat, int stagger_us, double *file_times) {
+    int group = b->rank / comm_size;
+    int ngroups = (b->nprocs + comm_size - 1) / comm_size;
+    MPI_Comm comm;
+    MPI_Comm_split(MPI_COMM_WORLD, group, b->rank, &comm);
+
+    size_t nsamples = (size_t) repeat * b->nfiles;
+    double *latency = (double*) malloc(nsamples * sizeof(double));
+    for (int f = 0; f < b->nfiles; f++)
+        file_times[f] = 0.0;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = get_time_sec();
+    for (int it = 0; it < repeat; it++) {
+        for (int f = 0; f < b->nfiles; f++) {
+            if (stagger_us > 0) {
+                MPI_Barrier(MPI_COMM_WORLD);
+                usleep((useconds_t) group * stagger_us);
+            }
+            double t0 = get_time_sec();
+            int ncid, ndims, nvars;
+            int retval = nc_open_par(b->file_list[f], NC_NOWRITE, comm, MPI_INFO_NULL, &ncid);
+            if (retval == NC_NOERR)
+                retval = nc_inq(ncid, &ndims, &nvars, NULL, NULL);
+            for (int varid = 0; retval == NC_NOERR && varid < nvars; varid++)
+                retval = nc_var_par_access(ncid, varid, b->use_independent ? NC_INDEPENDENT : NC_COLLECTIVE);
+            if (retval == NC_NOERR)
+                retval = nc_close(ncid);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error in metadata cycle for file %s: %s\n", b->rank, b->file_list[f], nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            double dt = get_time_sec() - t0;
+            latency[(size_t) it * b->nfiles + f] = dt;
+            file_times[f] += dt / repeat;
+        }
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_time = get_time_sec() - total_start;
+
+    // Latency percentiles over the open cycles of all ranks
+    double *all_latency = NULL;
+    if (b->rank == 0)
+        all_latency = (double*) malloc(nsamples * b->nprocs * sizeof(double));
+    MPI_Gather(latency, (int) nsamples, MPI_DOUBLE, all_latency, (int) nsamples, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        size_t n = nsamples * b->nprocs;
+        qsort(all_latency, n, sizeof(double), compare_double);
+        double opens = (double) ngroups * nsamples;
+        printf("metadata: comm_size=%d ; groups=%d ; stagger=%d us ; opens=%.0f ; wall_time=%.6f s ; opens_per_sec=%.2f\n",
+               comm_size, ngroups, stagger_us, opens, total_time, opens / total_time);
+        printf("metadata latency: p50=%.6f p90=%.6f p99=%.6f max=%.6f s\n",
+               percentile(all_latency, n, 50.0), percentile(all_latency, n, 90.0),
+               percentile(all_latency, n, 99.0), all_latency[n - 1]);
+        free(all_latency);
+    }
+    free(latency);
+    MPI_Comm_free(&comm);
+}
+
+// Function to split the pieces of an owner into at most tiles tiles each
+void task_layout(int ndims, const box_t *boxes, int npieces, int tiles, task_layout_t *tl) {
+    tl->npieces = npieces;
+    tl->per_var = 0;
+    tl->size = 0;
+    for (int p = 0; p < npieces; p++) {
+        size_t n = box_size(ndims, &boxes[p]);
+        tl->offset[p] = tl->size;
+        tl->size += n;
+        tl->split[p] = 0;
+        while (tl->split[p] < ndims - 1 && boxes[p].count[tl->split[p]] == 1)
+            tl->split[p]++;
+        size_t c = boxes[p].count[tl->split[p]];
+        tl->ntiles[p] = (n == 0) ? 0 : (c < (size_t) tiles ? (int) c : tiles);
+        tl->per_var += tl->ntiles[p];
+    }
+}
+
+// Function to get the box of task t (within one variable) and its offset in the owner's buffer
+void task_box(int ndims, const box_t *boxes, const task_layout_t *tl, int t, box_t *box, size_t *offset) {
+    int p = 0;
+    while (t >= tl->ntiles[p]) {
+        t -= tl->ntiles[p];
+        p++;
+    }
+    int d = tl->split[p];
+    size_t c = boxes[p].count[d];
+    size_t lo = c * t / tl->ntiles[p];
+    size_t hi = c * (t + 1) / tl->ntiles[p];
+    *box = boxes[p];
+    box->start[d] += lo;
+    box->count[d] = hi - lo;
+    size_t row = 1;
+    for (int e = d + 1; e < ndims; e++)
+        row *= boxes[p].count[e];
+    *offset = tl->offset[p] + lo * row;
+}
+
+// Work-stealing mode. The (variable, tile) read tasks of every owner form a
+// queue whose head is a counter in an MPI RMA window on the owner. Ranks first
+// drain their own queue with atomic fetch-and-op and then steal from the
+// queues of the other ranks, forwarding stolen tiles to the owner's data
+// window with MPI_Put. With steal == 0 the same tasks run statically on their
+// owner. Per-rank idle time (waiting for the slowest rank) and the makespan
+// are returned per file
+void run_steal(const bench_t *b, int tiles, int steal, double *file_times, double *idle_times,
+               double *makespans) {
+    int ndims = b->ndims;
+    int nprocs = b->nprocs;
+    box_t *all_boxes = (box_t*) malloc((size_t) nprocs * b->npieces * sizeof(box_t));
+    compute_all_boxes(b->nproc_x, b->nproc_y, b->halo, ndims, b->dimlen, b->lat_idx, b->lon_idx,
+                      b->npieces, all_boxes);
+    task_layout_t *layouts = (task_layout_t*) malloc(nprocs * sizeof(task_layout_t));
+    for (int r = 0; r < nprocs; r++)
+        task_layout(ndims, all_boxes + (size_t) r * b->npieces, b->npieces, tiles, &layouts[r]);
+    int *data_vars = (int*) malloc(b->nvars * sizeof(int));
+    for (int varid = 0, k = 0; varid < b->nvars + b->dimvars; varid++)
+        if (!b->is_dimvar[varid]) data_vars[k++] = varid;
+
+    // Data window holding all variables of one file, and the queue counter
+    size_t slot = layouts[b->rank].size;
+    float *data;
+    long *counter;
+    MPI_Win data_win, counter_win;
+    MPI_Win_allocate((MPI_Aint) (slot * b->nvars * sizeof(float)), sizeof(float), MPI_INFO_NULL,
+                     MPI_COMM_WORLD, &data, &data_win);
+    MPI_Win_allocate(sizeof(long), sizeof(long), MPI_INFO_NULL, MPI_COMM_WORLD, &counter, &counter_win);
+    MPI_Win_lock_all(0, data_win);
+    MPI_Win_lock_all(0, counter_win);
+    size_t maxtile = 0;
+    for (int r = 0; r < nprocs; r++)
+        if (layouts[r].size > maxtile) maxtile = layouts[r].size;
+    float *tilebuf = (float*) malloc((maxtile > 0 ? maxtile : 1) * sizeof(float));
+
+    for (int f = 0; f < b->nfiles; f++) {
+        int ncid = open_par(b, b->file_list[f], MPI_COMM_WORLD, 1);
+        long zero = 0, one = 1, old;
+        MPI_Accumulate(&zero, 1, MPI_LONG, b->rank, 0, 1, MPI_LONG, MPI_REPLACE, counter_win);
+        MPI_Win_flush(b->rank, counter_win);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        double file_start = get_time_sec();
+        int nvictims = steal ? nprocs : 1;
+        for (int v = 0; v < nvictims; v++) {
+            int owner = (b->rank + v) % nprocs;
+            const task_layout_t *tl = &layouts[owner];
+            long ntasks = (long) tl->per_var * b->nvars;
+            for (;;) {
+                MPI_Fetch_and_op(&one, &old, MPI_LONG, owner, 0, MPI_SUM, counter_win);
+                MPI_Win_flush(owner, counter_win);
+                if (old >= ntasks) break;
+                int k = (int) (old / tl->per_var);
+                box_t box;
+                size_t offset;
+                task_box(ndims, all_boxes + (size_t) owner * b->npieces, tl, (int) (old % tl->per_var), &box, &offset);
+                offset += k * tl->size;
+                float *dst = (owner == b->rank) ? data + offset : tilebuf;
+                int retval = nc_get_vara_float(ncid, data_vars[k], box.start, box.count, dst);
+                if (retval != NC_NOERR) {
+                    printf("Rank %d: Error reading tile of var %d for rank %d: %s\n", b->rank, data_vars[k], owner, nc_strerror(retval));
+                    safe_abort(MPI_COMM_WORLD, 1);
+                }
+                if (owner != b->rank) {
+                    MPI_Put(tilebuf, (int) box_size(ndims, &box), MPI_FLOAT, owner, (MPI_Aint) offset,
+                            (int) box_size(ndims, &box), MPI_FLOAT, data_win);
+                    MPI_Win_flush(owner, data_win);
+                }
+            }
+        }
+        double busy_end = get_time_sec();
+        nc_close(ncid);
+        MPI_Barrier(MPI_COMM_WORLD);
+        double file_end = get_time_sec();
+        MPI_Win_sync(data_win);
+        data[0] *= 3.4;
+
+        file_times[f] = file_end - file_start;
+        idle_times[f] = file_end - busy_end;
+        double busy = busy_end - file_start;
+        MPI_Allreduce(&busy, &makespans[f], 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    }
+
+    MPI_Win_unlock_all(counter_win);
+    MPI_Win_unlock_all(data_win);
+    MPI_Win_free(&counter_win);
+    MPI_Win_free(&data_win);
+    free(tilebuf);
+    free(data_vars);
+    free(layouts);
+    free(all_boxes);
+}
+
+// Ensemble mode. MPI_COMM_WORLD is split into members of nproc_x*nproc_y
+// consecutive ranks sharing one decomposition. With shared reads only member 0
+// reads each file and every subdomain is broadcast to the same grid position
+// of the other members over a column communicator; otherwise every member
+// reads the files itself. Returns the total wall time
+double run_ensemble(const bench_t *b, int members, int shared, double *file_times) {
+    int ncompute = b->nproc_x * b->nproc_y;
+    int member = b->rank / ncompute;
+    MPI_Comm member_comm, column_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, member, b->rank, &member_comm);
+    MPI_Comm_split(MPI_COMM_WORLD, b->rank % ncompute, b->rank, &column_comm);
+    size_t *start = (size_t*) malloc(b->ndims * sizeof(size_t));
+    size_t *count = (size_t*) malloc(b->ndims * sizeof(size_t));
+    for (int d = 0; d < b->ndims; d++) {
+        start[d] = 0;
+        count[d] = b->dimlen[d];
+    }
+    int reads = !shared || member == 0;
+    int n = (int) pieces_size(b, b->pieces);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = get_time_sec();
+    for (int f = 0; f < b->nfiles; f++) {
+        double file_start = get_time_sec();
+        int ncid = reads ? open_par(b, b->file_list[f], member_comm, b->use_independent) : -1;
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            if (reads) {
+                int retval = read_pieces(ncid, varid, b->ndims, b->lat_idx, b->lon_idx, b->pieces,
+                                         b->npieces, b->use_independent, start, count, b->buffer);
+                if (retval != NC_NOERR) {
+                    printf("Rank %d: Error reading subdomain for var %d: %s\n", b->rank, varid, nc_strerror(retval));
+                    safe_abort(MPI_COMM_WORLD, 1);
+                }
+            }
+            if (shared && members > 1)
+                MPI_Bcast(b->buffer, n, MPI_FLOAT, 0, column_comm);
+            b->buffer[0] *= 3.4;
+        }
+        if (reads)
+            nc_close(ncid);
+        MPI_Barrier(MPI_COMM_WORLD);
+        file_times[f] = get_time_sec() - file_start;
+    }
+    double total_time = get_time_sec() - t0;
+
+    MPI_Comm_free(&column_comm);
+    MPI_Comm_free(&member_comm);
+    free(start);
+    free(count);
+    return total_time;
+}
+
+// Function to read the file set of one job on job_comm: all files for
+// overlapping sets, every njobs-th file starting at job for disjoint sets.
+// Returns the elapsed time
+double read_job_files(const bench_t *b, MPI_Comm job_comm, int job, int njobs, int overlap,
+                      size_t *start, size_t *count, double *file_times) {
+    double t0 = get_time_sec();
+    for (int f = overlap ? 0 : job; f < b->nfiles; f += overlap ? 1 : njobs) {
+        double file_start = get_time_sec();
+        int ncid = open_par(b, b->file_list[f], job_comm, b->use_independent);
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            int retval = read_pieces(ncid, varid, b->ndims, b->lat_idx, b->lon_idx, b->pieces,
+                                     b->npieces, b->use_independent, start, count, b->buffer);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error reading subdomain for var %d: %s\n", b->rank, varid, nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            b->buffer[0] *= 3.4;
+        }
+        nc_close(ncid);
+        MPI_Barrier(job_comm);
+        if (file_times)
+            file_times[f] = get_time_sec() - file_start;
+    }
+    return get_time_sec() - t0;
+}
+
+// Interference mode. MPI_COMM_WORLD is split into njobs independent reader
+// jobs of nproc_x*nproc_y consecutive ranks. Each job first reads its file set
+// alone while the other jobs wait, then all jobs read at the same time, job j
+// starting j * offset_us microseconds after a common barrier. The solo and
+// shared time of each job are returned on all ranks
+void run_interference(const bench_t *b, int njobs, int overlap, int offset_us, double *file_times,
+                      double *solo_times, double *shared_times) {
+    int job = b->rank / (b->nproc_x * b->nproc_y);
+    MPI_Comm job_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, job, b->rank, &job_comm);
+    size_t *start = (size_t*) malloc(b->ndims * sizeof(size_t));
+    size_t *count = (size_t*) malloc(b->ndims * sizeof(size_t));
+    for (int d = 0; d < b->ndims; d++) {
+        start[d] = 0;
+        count[d] = b->dimlen[d];
+    }
+    for (int j = 0; j < njobs; j++) {
+        solo_times[j] = 0.0;
+        shared_times[j] = 0.0;
+    }
+
+    // Solo baseline, one job after the other
+    for (int j = 0; j < njobs; j++) {
+        MPI_Barrier(MPI_COMM_WORLD);
+        if (j == job)
+            solo_times[j] = read_job_files(b, job_comm, job, njobs, overlap, start, count, NULL);
+    }
+
+    // All jobs at the same time
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (offset_us > 0)
+        usleep((useconds_t) job * offset_us);
+    shared_times[job] = read_job_files(b, job_comm, job, njobs, overlap, start, count, file_times);
+    MPI_Allreduce(MPI_IN_PLACE, solo_times, njobs, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, shared_times, njobs, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+
+    MPI_Comm_free(&job_comm);
+    free(start);
+    free(count);
+}
+
+// Synthetic compute load: relaxation sweeps over the data until seconds have passed
+void compute_load(float *data, size_t n, double seconds) {
+    const size_t chunk = 1 << 20;
+    double end = get_time_sec() + seconds;
+    size_t i = 1;
+    while (n > 1 && get_time_sec() < end) {
+        size_t stop = (i + chunk < n) ? i + chunk : n;
+        for (; i < stop; i++)
+            data[i] = 0.5f * (data[i] + data[i - 1]);
+        if (i == n) i = 1;
+    }
+}
+
+// Dedicated I/O server mode. The last nservers ranks only read and the first
+// nproc_x*nproc_y ranks only compute. Each server reads the subdomains of the
+// compute ranks assigned to it round-robin (netCDF decompresses and converts
+// to float) and ships every variable with MPI_Isend, double-buffered over the
+// variables. Compute ranks post the receives for the next file before running
+// the synthetic load on the current one; the time spent waiting for the data
+// of a file is its stall time
+void run_ioserver(const bench_t *b, int nservers, double compute_time, double *file_times,
+                  double *stall_times) {
+    int ndims = b->ndims;
+    int ncompute = b->nproc_x * b->nproc_y;
+    int is_server = (b->rank >= ncompute);
+    MPI_Comm server_comm;
+    MPI_Comm_split(MPI_COMM_WORLD, is_server, b->rank, &server_comm);
+    size_t *start = (size_t*) malloc(ndims * sizeof(size_t));
+    size_t *count = (size_t*) malloc(ndims * sizeof(size_t));
+    for (int d = 0; d < ndims; d++) {
+        start[d] = 0;
+        count[d] = b->dimlen[d];
+    }
+
+    if (is_server) {
+        int server = b->rank - ncompute;
+        int nowned = (ncompute - server + nservers - 1) / nservers;
+        piece_t (*owned)[NPIECES] = malloc((nowned > 0 ? nowned : 1) * sizeof(*owned));
+        for (int i = 0; i < nowned; i++) {
+            int q = server + i * nservers;
+            compute_pieces(q % b->nproc_x, q / b->nproc_x, b->nproc_x, b->nproc_y, b->halo,
+                           b->dimlen[b->lon_idx], b->dimlen[b->lat_idx], owned[i]);
+        }
+        // Two variable slots per owned subdomain, so that reading one variable
+        // overlaps the sends of the previous one
+        float *sendbuf = (float*) malloc((2 * (size_t) nowned * b->bufsize + 1) * sizeof(float));
+        MPI_Request *reqs = (MPI_Request*) malloc((2 * nowned + 1) * sizeof(MPI_Request));
+        for (int i = 0; i < 2 * nowned; i++)
+            reqs[i] = MPI_REQUEST_NULL;
+
+        for (int f = 0; f < b->nfiles; f++) {
+            double file_start = get_time_sec();
+            int ncid = open_par(b, b->file_list[f], server_comm, 1);
+            for (int varid = 0, k = 0; varid < b->nvars + b->dimvars; varid++) {
+                if (b->is_dimvar[varid]) continue;
+                int slot = k % 2;
+                MPI_Waitall(nowned, reqs + slot * nowned, MPI_STATUSES_IGNORE);
+                for (int i = 0; i < nowned; i++) {
+                    float *dst = sendbuf + ((size_t) slot * nowned + i) * b->bufsize;
+                    int retval = read_pieces(ncid, varid, ndims, b->lat_idx, b->lon_idx, owned[i],
+                                             b->npieces, 1, start, count, dst);
+                    if (retval != NC_NOERR) {
+                        printf("Rank %d: Error reading var %d for rank %d: %s\n", b->rank, varid,
+                               server + i * nservers, nc_strerror(retval));
+                        safe_abort(MPI_COMM_WORLD, 1);
+                    }
+                    MPI_Isend(dst, (int) pieces_size(b, owned[i]), MPI_FLOAT, server + i * nservers, (f % 2) * b->nvars + k,
+                              MPI_COMM_WORLD, &reqs[slot * nowned + i]);
+                }
+                k++;
+            }
+            nc_close(ncid);
+            file_times[f] = get_time_sec() - file_start;
+        }
+        MPI_Waitall(2 * nowned, reqs, MPI_STATUSES_IGNORE);
+        free(reqs);
+        free(sendbuf);
+        free(owned);
+    } else {
+        // Two file slots holding all variables
+        int source = ncompute + b->rank % nservers;
+        size_t slot_size = (size_t) b->nvars * b->bufsize;
+        float *recvbuf = (float*) malloc((2 * slot_size + 1) * sizeof(float));
+        MPI_Request *reqs = (MPI_Request*) malloc((2 * b->nvars + 1) * sizeof(MPI_Request));
+        for (int f = 0; f < b->nfiles && f < 2; f++)
+            for (int k = 0; k < b->nvars; k++)
+                MPI_Irecv(recvbuf + (f * b->nvars + k) * b->bufsize, (int) b->bufsize, MPI_FLOAT,
+                          source, f * b->nvars + k, MPI_COMM_WORLD, &reqs[f * b->nvars + k]);
+
+        for (int f = 0; f < b->nfiles; f++) {
+            int slot = f % 2;
+            double file_start = get_time_sec();
+            MPI_Waitall(b->nvars, reqs + slot * b->nvars, MPI_STATUSES_IGNORE);
+            stall_times[f] = get_time_sec() - file_start;
+            compute_load(recvbuf + slot * slot_size, slot_size, compute_time);
+            // The slot is free again, receive file f+2 into it
+            if (f + 2 < b->nfiles)
+                for (int k = 0; k < b->nvars; k++)
+                    MPI_Irecv(recvbuf + (slot * b->nvars + k) * b->bufsize, (int) b->bufsize, MPI_FLOAT,
+                              source, slot * b->nvars + k, MPI_COMM_WORLD, &reqs[slot * b->nvars + k]);
+            file_times[f] = get_time_sec() - file_start;
+        }
+        free(reqs);
+        free(recvbuf);
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Comm_free(&server_comm);
+    free(start);
+    free(count);
+}
+
+// Function to parse a decomposition "NAME:NPROC[:HALO[:periodic]],..." into
+// split. Returns the number of decomposed dimensions or -1 on errors
+int parse_decomp(const char *spec, split_dim_t *split, int max) {
+    int nsplit = 0;
+    const char *p = spec;
+    while (*p != '\0') {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t) (end - p) : strlen(p);
+        char item[2 * NC_MAX_NAME];
+        if (nsplit == max || len >= sizeof(item))
+            return -1;
+        memcpy(item, p, len);
+        item[len] = '\0';
+        split_dim_t *sd = &split[nsplit++];
+        char *field = strtok(item, ":");
+        if (!field || strlen(field) > NC_MAX_NAME)
+            return -1;
+        strcpy(sd->name, field);
+        field = strtok(NULL, ":");
+        sd->nproc = field ? atoi(field) : 0;
+        field = strtok(NULL, ":");
+        sd->halo = field ? atoi(field) : 0;
+        field = strtok(NULL, ":");
+        sd->periodic = field && strcmp(field, "periodic") == 0;
+        if (sd->nproc < 1 || sd->halo < 0 || (field && !sd->periodic))
+            return -1;
+        p += len + (end ? 1 : 0);
+    }
+    return nsplit;
+}
+
+// Function to compute the segments of the block of coordinate c out of nproc
+// along a dimension of length len, extended by halo: the block itself and,
+// for periodic dimensions, the halo wrapped around the lower and upper
+// boundary. Absent segments have a zero count. Returns the number of segments
+int split_segments(size_t len, int c, const split_dim_t *sd, size_t *start, size_t *count) {
+    long sub = (long) len / sd->nproc;
+    long lo = c * sub - sd->halo, hi = c * sub + sub - 1 + sd->halo;
+    long h = (sd->halo < (long) len) ? sd->halo : (long) len;
+    start[0] = lo < 0 ? 0 : lo;
+    count[0] = (hi >= (long) len ? (long) len - 1 : hi) - (long) start[0] + 1;
+    if (!sd->periodic)
+        return 1;
+    start[1] = lo < 0 ? len - (-lo < h ? -lo : h) : 0;
+    count[1] = lo < 0 ? len - start[1] : 0;
+    start[2] = 0;
+    count[2] = hi >= (long) len ? (hi - (long) len + 1 < h ? hi - (long) len + 1 : h) : 0;
+    return 3;
+}
+
+// N-dimensional mode over the direct engine, with the decomposition of
+// ddr_decompose_nd. Rank 0 reports the buffer size of every rank, which
+// differs with the segments of each rank
+void run_nd(const bench_t *b, double *file_times) {
+    unsigned long long size = b->bufsize, *sizes = NULL;
+    if (b->rank == 0)
+        sizes = (unsigned long long*) malloc(b->nprocs * sizeof(unsigned long long));
+    MPI_Gather(&size, 1, MPI_UNSIGNED_LONG_LONG, sizes, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    for (int r = 0; b->rank == 0 && r < b->nprocs; r++)
+        printf("Rank %d: nd buffer of %llu floats\n", r, sizes[r]);
+    free(sizes);
+
+    ddr_reader_t r;
+    ddr_reader_init(&r, ddr_find_engine("direct"), b, MPI_COMM_WORLD, NULL);
+    for (int f = 0; f < b->nfiles; f++) {
+        ddr_open(&r, b->file_list[f]);
+        double file_start = get_time_sec();
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            int retval = ddr_read(&r, varid, b->buffer);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error reading var %d: %s\n", b->rank, varid, nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            b->buffer[0] *= 3.4;
+        }
+        ddr_close(&r);
+        MPI_Barrier(MPI_COMM_WORLD);
+        file_times[f] = get_time_sec() - file_start;
+    }
+    ddr_reader_free(&r);
+}
+
+// Function to estimate the read cost of the nvars data variables on a
+// nproc_x x nproc_y grid. Chunked variables (chunked[v] set, chunk shape in
+// chunks[v * ndims...]) cost one request per chunk touched and read whole
+// chunks; contiguous variables cost one request per contiguous run of the
+// row-major layout. The cost of a rank is summed over all variables
+void score_grid(int nproc_x, int nproc_y, int halo, int ndims, const size_t *dimlen, int lat_idx,
+                int lon_idx, int nvars, const int *chunked, const size_t *chunks, double request_bytes,
+                grid_score_t *gs) {
+    int npieces = (halo > 0) ? NPIECES : 1;
+    int sub_lon = dimlen[lon_idx] / nproc_x, sub_lat = dimlen[lat_idx] / nproc_y;
+    double var_cells = 1.0, other = 1.0;
+    for (int d = 0; d < ndims; d++) {
+        var_cells *= dimlen[d];
+        if (d != lat_idx && d != lon_idx) other *= dimlen[d];
+    }
+    double total_touched = 0.0;
+    gs->nproc_x = nproc_x;
+    gs->nproc_y = nproc_y;
+    gs->score = -1.0;
+    gs->trial_time = -1.0;
+    for (int r = 0; r < nproc_x * nproc_y; r++) {
+        piece_t pieces[NPIECES];
+        compute_pieces(r % nproc_x, r / nproc_x, nproc_x, nproc_y, halo, dimlen[lon_idx], dimlen[lat_idx], pieces);
+        double requests = 0.0, cells = 0.0, touched = 0.0;
+        for (int p = 0; p < npieces; p++) {
+            if (pieces[p].nlon == 0) continue;
+            box_t box;
+            piece_box(&pieces[p], ndims, dimlen, lat_idx, lon_idx, &box);
+            cells += nvars * box_size(ndims, &box);
+            for (int v = 0; v < nvars; v++) {
+                if (chunked[v]) {
+                    const size_t *chunk = chunks + (size_t) v * ndims;
+                    double nchunks = 1.0, covered = 1.0;
+                    for (int d = 0; d < ndims; d++) {
+                        size_t first = box.start[d] / chunk[d];
+                        size_t last = (box.start[d] + box.count[d] - 1) / chunk[d];
+                        size_t end = (last + 1) * chunk[d];
+                        nchunks *= last - first + 1;
+                        covered *= (end < dimlen[d] ? end : dimlen[d]) - first * chunk[d];
+                    }
+                    requests += nchunks;
+                    touched += covered;
+                } else {
+                    int j = -1;
+                    for (int d = 0; d < ndims; d++)
+                        if (box.count[d] < dimlen[d]) j = d;
+                    double runs = 1.0;
+                    for (int d = 0; d < j; d++)
+                        runs *= box.count[d];
+                    requests += runs;
+                    touched += box_size(ndims, &box);
+                }
+            }
+        }
+        double cost = touched * sizeof(float) + requests * request_bytes;
+        if (cost > gs->score) {
+            gs->score = cost;
+            gs->requests = requests;
+            gs->halo_cells = cells - (double) nvars * sub_lat * sub_lon * other;
+        }
+        total_touched += touched;
+    }
+    gs->duplication = (nvars > 0) ? total_touched / (var_cells * nvars) : 1.0;
+}
+
+// Function to order grid candidates by measured time if tried, else by score,
+// breaking ties by halo surface and chunk duplication
+int compare_grid(const void *a, const void *b) {
+    const grid_score_t *ga = (const grid_score_t*) a, *gb = (const grid_score_t*) b;
+    double ka = (ga->trial_time >= 0.0 && gb->trial_time >= 0.0) ? ga->trial_time : ga->score;
+    double kb = (ga->trial_time >= 0.0 && gb->trial_time >= 0.0) ? gb->trial_time : gb->score;
+    if (ka != kb)
+        return (ka > kb) - (ka < kb);
+    if (ga->halo_cells != gb->halo_cells)
+        return (ga->halo_cells > gb->halo_cells) - (ga->halo_cells < gb->halo_cells);
+    return (ga->duplication > gb->duplication) - (ga->duplication < gb->duplication);
+}
+
+// Number of timed reads of each grid candidate in choose_grid
+enum { GRID_TRIAL_ROUNDS = 3 };
+
+// Function to read all data variables of the open file ncid with independent
+// access on a nx x ny grid. Returns the time of the slowest rank
+static double grid_trial(int ncid, int nx, int ny, int halo, int ndims, const size_t *dimlen, int lat_idx,
+                         int lon_idx, int nvars, const int *is_dimvar, float *buffer) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    piece_t pieces[NPIECES];
+    compute_pieces(rank % nx, rank / nx, nx, ny, halo, dimlen[lon_idx], dimlen[lat_idx], pieces);
+    size_t start[MAX_DIMS], count[MAX_DIMS];
+    for (int d = 0; d < ndims; d++) {
+        start[d] = 0;
+        count[d] = dimlen[d];
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+    double t0 = get_time_sec();
+    for (int v = 0; v < nvars; v++) {
+        if (is_dimvar[v]) continue;
+        int retval = nc_var_par_access(ncid, v, NC_INDEPENDENT);
+        if (retval == NC_NOERR)
+            retval = read_pieces(ncid, v, ndims, lat_idx, lon_idx, pieces, (halo > 0) ? NPIECES : 1, 1,
+                                 start, count, buffer);
+        if (retval != NC_NOERR) {
+            printf("Rank %d: Error reading var %d in grid trial: %s\n", rank, v, nc_strerror(retval));
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+    }
+    double elapsed = get_time_sec() - t0, slowest;
+    MPI_Allreduce(&elapsed, &slowest, 1, MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
+    return slowest;
+}
+
+// Function to choose the process grid for nranks ranks from the dimension
+// order and chunk shapes of the data variables of the open file ncid.
+// All factorisations are scored; with trials > 0 the best ones read the
+// first file with independent access and the fastest is taken. An untimed
+// pass first brings the file into the page cache, then the candidates read
+// it in GRID_TRIAL_ROUNDS interleaved rounds and keep their fastest time,
+// so no candidate is favoured by the order of the trials
+grid_score_t choose_grid(int ncid, int nranks, int halo, int ndims, const size_t *dimlen, int lat_idx,
+                         int lon_idx, int nvars, const int *is_dimvar, double request_bytes, int trials) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int ndata = 0;
+    int *chunked = (int*) malloc((nvars + 1) * sizeof(int));
+    size_t *chunks = (size_t*) malloc(((size_t) nvars * ndims + 1) * sizeof(size_t));
+    for (int v = 0; v < nvars; v++) {
+        if (is_dimvar[v]) continue;
+        int storage = NC_CONTIGUOUS;
+        size_t shape[NC_MAX_VAR_DIMS];
+        if (nc_inq_var_chunking(ncid, v, &storage, shape) != NC_NOERR)
+            storage = NC_CONTIGUOUS;
+        chunked[ndata] = (storage == NC_CHUNKED);
+        memcpy(chunks + (size_t) ndata * ndims, shape, ndims * sizeof(size_t));
+        ndata++;
+    }
+
+    grid_score_t *cand = (grid_score_t*) malloc(nranks * sizeof(grid_score_t));
+    int ncand = 0;
+    for (int nx = 1; nx <= nranks; nx++) {
+        int ny = nranks / nx;
+        if (nx * ny != nranks || (size_t) nx > dimlen[lon_idx] || (size_t) ny > dimlen[lat_idx])
+            continue;
+        score_grid(nx, ny, halo, ndims, dimlen, lat_idx, lon_idx, ndata, chunked, chunks,
+                   request_bytes, &cand[ncand++]);
+    }
+    free(chunked);
+    free(chunks);
+    if (ncand == 0) {
+        if (rank == 0)
+            printf("Error: no process grid of %d ranks fits the %zux%zu domain\n", nranks,
+                   dimlen[lon_idx], dimlen[lat_idx]);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    qsort(cand, ncand, sizeof(grid_score_t), compare_grid);
+
+    // Read the first file with the best candidates, after an untimed warm-up
+    if (trials > ncand)
+        trials = ncand;
+    if (trials > 0) {
+        size_t bufsize = 0;
+        for (int i = 0; i < trials; i++) {
+            int nx = cand[i].nproc_x, ny = cand[i].nproc_y;
+            size_t size = (size_t) (dimlen[lat_idx] / ny + 2 * halo) * (dimlen[lon_idx] / nx + 2 * halo);
+            for (int d = 0; d < ndims; d++)
+                if (d != lat_idx && d != lon_idx) size *= dimlen[d];
+            if (size > bufsize) bufsize = size;
+        }
+        float *buffer = (float*) malloc(bufsize * sizeof(float));
+        grid_trial(ncid, cand[0].nproc_x, cand[0].nproc_y, halo, ndims, dimlen, lat_idx, lon_idx,
+                   nvars, is_dimvar, buffer);
+        for (int round = 0; round < GRID_TRIAL_ROUNDS; round++) {
+            for (int i = 0; i < trials; i++) {
+                double t = grid_trial(ncid, cand[i].nproc_x, cand[i].nproc_y, halo, ndims, dimlen, lat_idx,
+                                      lon_idx, nvars, is_dimvar, buffer);
+                if (cand[i].trial_time < 0.0 || t < cand[i].trial_time)
+                    cand[i].trial_time = t;
+            }
+        }
+        free(buffer);
+    }
+    qsort(cand, trials, sizeof(grid_score_t), compare_grid);
+
+    if (rank == 0) {
+        for (int i = 0; i < ncand; i++) {
+            printf("grid_candidate: %dx%d ; requests=%.0f ; halo_cells=%.0f ; chunk_duplication=%.3f ; score=%.0f",
+                   cand[i].nproc_x, cand[i].nproc_y, cand[i].requests, cand[i].halo_cells,
+                   cand[i].duplication, cand[i].score);
+            if (cand[i].trial_time >= 0.0)
+                printf(" ; trial_time=%.6f s", cand[i].trial_time);
+            printf("\n");
+        }
+    }
+    grid_score_t best = cand[0];
+    free(cand);
+    return best;
+}
+
+// Function to find the level window [*level0, *level0 + *nlevel) along the
+// dimension dim_name from a "LO:HI" range, given either as inclusive indices
+// or as coordinate values looked up in the coordinate variable of the dimension
+void find_level_window(int ncid, const char *dim_name, const char *range, int by_value,
+                       int *level_idx, size_t *level0, size_t *nlevel) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    size_t len;
+    double lo, hi;
+    if (nc_inq_dimid(ncid, dim_name, level_idx) != NC_NOERR
+        || nc_inq_dim(ncid, *level_idx, NULL, &len) != NC_NOERR
+        || sscanf(range, "%lf:%lf", &lo, &hi) != 2) {
+        if (rank == 0)
+            printf("Error: invalid level window %s=%s\n", dim_name, range);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    if (lo > hi) {
+        double tmp = lo;
+        lo = hi;
+        hi = tmp;
+    }
+    long first = -1, last = -1;
+    if (by_value) {
+        int varid;
+        double *values = (double*) malloc(len * sizeof(double));
+        if (nc_inq_varid(ncid, dim_name, &varid) != NC_NOERR || nc_get_var_double(ncid, varid, values) != NC_NOERR) {
+            if (rank == 0)
+                printf("Error: could not read coordinate variable %s\n", dim_name);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        // Levels are monotonic, so the matching values form one index range
+        for (size_t i = 0; i < len; i++) {
+            if (values[i] >= lo && values[i] <= hi) {
+                if (first < 0) first = (long) i;
+                last = (long) i;
+            }
+        }
+        free(values);
+    } else if (lo >= 0 && hi < (double) len) {
+        first = (long) lo;
+        last = (long) hi;
+    }
+    if (first < 0) {
+        if (rank == 0)
+            printf("Error: level window %s=%s selects no levels\n", dim_name, range);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    *level0 = (size_t) first;
+    *nlevel = (size_t) (last - first + 1);
+}
+
+// Function to print the bytes requested by a level window and the bytes of the
+// chunks it touches for each data variable. Chunks spanning more levels than
+// the window are read in full, so a layout with full-depth chunks saves nothing
+void report_level_window(int ncid, int nvars, const int *is_dimvar, char (*varnames)[NC_MAX_NAME + 1],
+                         const size_t *dimlen, int level_idx, size_t level0, size_t nlevel) {
+    double total_requested = 0.0, total_touched = 0.0, total_full = 0.0;
+    for (int varid = 0; varid < nvars; varid++) {
+        if (is_dimvar[varid]) continue;
+        int vndims, storage;
+        int dimids[NC_MAX_VAR_DIMS];
+        size_t chunks[NC_MAX_VAR_DIMS];
+        if (nc_inq_varndims(ncid, varid, &vndims) != NC_NOERR || nc_inq_vardimid(ncid, varid, dimids) != NC_NOERR
+            || nc_inq_var_chunking(ncid, varid, &storage, chunks) != NC_NOERR) {
+            printf("Error querying layout of var %s\n", varnames[varid]);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        double full = sizeof(float);
+        int pos = -1;
+        for (int i = 0; i < vndims; i++) {
+            full *= dimlen[dimids[i]];
+            if (dimids[i] == level_idx) pos = i;
+        }
+        size_t len = dimlen[level_idx];
+        size_t chunk = (pos >= 0 && storage == NC_CHUNKED) ? chunks[pos] : 1;
+        double requested = full, touched = full;
+        if (pos >= 0) {
+            size_t first = level0 / chunk * chunk;
+            size_t end = ((level0 + nlevel - 1) / chunk + 1) * chunk;
+            requested = full / len * nlevel;
+            touched = full / len * ((end < len ? end : len) - first);
+        }
+        printf("level_window: var=%s ; layout=%s ; level_chunk=%zu ; requested=%f MB ; touched=%f MB ; saved=%f MB\n",
+               varnames[varid], storage == NC_CHUNKED ? "chunked" : "contiguous", pos >= 0 ? chunk : 0,
+               requested / 1e6, touched / 1e6, (full - touched) / 1e6);
+        total_requested += requested;
+        total_touched += touched;
+        total_full += full;
+    }
+    printf("level_window: levels=%zu:%zu (%zu of %zu) ; requested=%f MB ; touched=%f MB ; saved=%f MB\n",
+           level0, level0 + nlevel - 1, nlevel, dimlen[level_idx], total_requested / 1e6,
+           total_touched / 1e6, (total_full - total_touched) / 1e6);
+}
+
+// Function to get the extents of each piece of the subdomain of b, with count
+// holding the extents of the non-decomposed dimensions, and the number of
+// floats of each piece. Returns the number of floats of all pieces
+size_t piece_counts(const bench_t *b, const size_t *count, size_t (*counts)[MAX_DIMS], size_t *sizes) {
+    size_t n = 0;
+    for (int p = 0; p < b->npieces; p++) {
+        sizes[p] = 1;
+        for (int d = 0; d < b->ndims; d++) {
+            counts[p][d] = (d == b->lat_idx) ? (size_t) b->pieces[p].nlat
+                         : (d == b->lon_idx) ? (size_t) b->pieces[p].nlon : count[d];
+            sizes[p] *= counts[p][d];
+        }
+        n += sizes[p];
+    }
+    return n;
+}
+
+// Function to find the target layout given as a comma-separated list of all
+// dimension names from slowest to fastest varying. Sets perm[k] to the file
+// dimension at position k of the target layout
+void find_layout(int ncid, const char *spec, int ndims, int *perm) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int seen[MAX_DIMS] = {0};
+    int k = 0;
+    const char *p = spec;
+    while (*p != '\0' && k < ndims && ndims <= MAX_DIMS) {
+        char name[NC_MAX_NAME + 1];
+        size_t len = strcspn(p, ",");
+        int dimid;
+        if (len > NC_MAX_NAME) break;
+        memcpy(name, p, len);
+        name[len] = '\0';
+        if (nc_inq_dimid(ncid, name, &dimid) != NC_NOERR || dimid >= ndims || seen[dimid]) break;
+        seen[dimid] = 1;
+        perm[k++] = dimid;
+        p += len;
+        if (*p == ',') p++;
+    }
+    if (k != ndims || *p != '\0') {
+        if (rank == 0)
+            printf("Error: layout %s must list each of the %d dimensions once\n", spec, ndims);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Function to copy an array with the extents count, stored in file order, into
+// dst with its dimensions in the order perm. Walks dst sequentially and
+// gathers the innermost dimension of dst from src with a constant stride
+void permute_box(int ndims, const size_t *count, const int *perm, const float *src, float *dst) {
+    size_t src_stride[MAX_DIMS], stride[MAX_DIMS], idx[MAX_DIMS];
+    size_t n = 1;
+    for (int d = ndims - 1; d >= 0; d--) {
+        src_stride[d] = n;
+        n *= count[d];
+    }
+    if (n == 0 || ndims < 1) return;
+    for (int k = 0; k < ndims; k++) {
+        stride[k] = src_stride[perm[k]];
+        idx[k] = 0;
+    }
+    int last = ndims - 1;
+    size_t inner = count[perm[last]], step = stride[last], off = 0;
+    for (size_t i = 0; i < n; i += inner) {
+        const float *s = src + off;
+        for (size_t j = 0; j < inner; j++)
+            dst[i + j] = s[j * step];
+        for (int k = last - 1; k >= 0; k--) {
+            off += stride[k];
+            if (++idx[k] < count[perm[k]]) break;
+            off -= stride[k] * count[perm[k]];
+            idx[k] = 0;
+        }
+    }
+}
+
+// Function to read all pieces of one variable like read_pieces, but with
+// nc_get_varm_float so that each piece lands in buffer with its dimensions in
+// the order perm instead of the file order, without an intermediate copy
+int read_pieces_mapped(int ncid, int varid, int ndims, int lat_idx, int lon_idx,
+                       const piece_t *pieces, int npieces, int use_independent, const int *perm,
+                       size_t *start, size_t *count, float *buffer) {
+    ptrdiff_t imap[MAX_DIMS];
+    float *dst = buffer;
+    for (int p = 0; p < npieces; p++) {
+        if (pieces[p].nlon == 0 && use_independent) continue;
+        start[lat_idx] = pieces[p].lat0;
+        start[lon_idx] = pieces[p].lon0;
+        count[lat_idx] = pieces[p].nlat;
+        count[lon_idx] = pieces[p].nlon;
+        // Distance in buffer between neighbours along each file dimension
+        size_t n = 1;
+        for (int k = ndims - 1; k >= 0; k--) {
+            imap[perm[k]] = (ptrdiff_t) n;
+            n *= count[perm[k]];
+        }
+        int retval = nc_get_varm_float(ncid, varid, start, count, NULL, imap, dst);
+        if (retval != NC_NOERR)
+            return retval;
+        dst += n;
+    }
+    return NC_NOERR;
+}
+
+// Function to transpose a block of at most 8x8 elements of src (row stride
+// lds) into dst (row stride ldd). With AVX the block is transposed in
+// registers, using masked loads and stores for partial blocks
+static void transpose_block(const float *src, size_t lds, float *dst, size_t ldd, size_t nr, size_t nc) {
+#ifdef __AVX__
+    static const int lane_mask[16] = { -1, -1, -1, -1, -1, -1, -1, -1, 0, 0, 0, 0, 0, 0, 0, 0 };
+    __m256 r[8], t[8], u[8];
+    int full = (nr == 8 && nc == 8);
+    __m256i load_mask = _mm256_loadu_si256((const __m256i*) (lane_mask + 8 - nc));
+    __m256i store_mask = _mm256_loadu_si256((const __m256i*) (lane_mask + 8 - nr));
+    for (size_t k = 0; k < 8; k++)
+        r[k] = full ? _mm256_loadu_ps(src + k * lds)
+             : (k < nr) ? _mm256_maskload_ps(src + k * lds, load_mask) : _mm256_setzero_ps();
+    for (int k = 0; k < 8; k += 2) {
+        t[k] = _mm256_unpacklo_ps(r[k], r[k + 1]);
+        t[k + 1] = _mm256_unpackhi_ps(r[k], r[k + 1]);
+    }
+    for (int k = 0; k < 8; k += 4) {
+        u[k] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(1, 0, 1, 0));
+        u[k + 1] = _mm256_shuffle_ps(t[k], t[k + 2], _MM_SHUFFLE(3, 2, 3, 2));
+        u[k + 2] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(1, 0, 1, 0));
+        u[k + 3] = _mm256_shuffle_ps(t[k + 1], t[k + 3], _MM_SHUFFLE(3, 2, 3, 2));
+    }
+    for (int k = 0; k < 4; k++) {
+        r[k] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x20);
+        r[k + 4] = _mm256_permute2f128_ps(u[k], u[k + 4], 0x31);
+    }
+    for (size_t k = 0; k < nc; k++) {
+        if (full)
+            _mm256_storeu_ps(dst + k * ldd, r[k]);
+        else
+            _mm256_maskstore_ps(dst + k * ldd, store_mask, r[k]);
+    }
+#else
+    for (size_t i = 0; i < nr; i++)
+        for (size_t j = 0; j < nc; j++)
+            dst[j * ldd + i] = src[i * lds + j];
+#endif
+}
+
+// Function to transpose the rows x cols matrix src (row stride lds) into dst
+// (row stride ldd). The matrix is walked in tiles that fit into L1 together
+// with their transpose, each tile in 8x8 blocks
+void transpose_2d(const float *src, size_t lds, float *dst, size_t ldd, size_t rows, size_t cols) {
+    const size_t tile = 64;
+    for (size_t i0 = 0; i0 < rows; i0 += tile) {
+        size_t i1 = (i0 + tile < rows) ? i0 + tile : rows;
+        for (size_t j0 = 0; j0 < cols; j0 += tile) {
+            size_t j1 = (j0 + tile < cols) ? j0 + tile : cols;
+            for (size_t i = i0; i < i1; i += 8)
+                for (size_t j = j0; j < j1; j += 8)
+                    transpose_block(src + i * lds + j, lds, dst + j * ldd + i, ldd,
+                                    (i1 - i < 8) ? i1 - i : 8, (j1 - j < 8) ? j1 - j : 8);
+        }
+    }
+}
+
+// Function to move dimension col_idx of an array with the extents count,
+// stored in file order, to the fastest varying position: one transpose of a
+// count[col_idx] x (product of the faster dimensions) matrix per outer index
+void transform_columns(int ndims, const size_t *count, int col_idx, const float *src, float *dst) {
+    size_t outer = 1, inner = 1;
+    for (int d = 0; d < col_idx; d++)
+        outer *= count[d];
+    for (int d = col_idx + 1; d < ndims; d++)
+        inner *= count[d];
+    size_t block = count[col_idx] * inner;
+    for (size_t o = 0; o < outer; o++)
+        transpose_2d(src + o * block, inner, dst + o * block, count[col_idx], count[col_idx], inner);
+}
+
+// Function to interleave nfields arrays of n floats, field f starting at
+// src + f * lds, into dst with all fields of one grid cell next to each other
+void transform_interleave(int nfields, size_t n, const float *src, size_t lds, float *dst) {
+    transpose_2d(src, lds, dst, nfields, nfields, n);
+}
+
+// Function to draw a uniform random number in [0, 1) from a linear
+// congruential generator, so that every rank draws the same positions on
+// every platform for a given seed
+static float uniform(unsigned *state) {
+    *state = *state * 1664525u + 1013904223u;
+    return (float) ((*state >> 8) / 16777216.0);
+}
+
+// Function to find the trilinear cell of position (z, y, x) inside a block
+// with the extents size: the lower corner lo, the upper corner hi (clamped to
+// the block, so positions on the last plane reuse it) and the weights w
+static inline void trilinear_cell(float z, float y, float x, const size_t *size, size_t *lo, size_t *hi,
+                                  float *w) {
+    float c[3] = { z, y, x };
+    for (int d = 0; d < 3; d++) {
+        lo[d] = (size_t) c[d];
+        hi[d] = (lo[d] + 1 < size[d]) ? lo[d] + 1 : lo[d];
+        w[d] = c[d] - (float) lo[d];
+    }
+}
+
+// Function to get the offset of the lower corner of a cell with the given
+// strides, and in delta the steps to its upper corner (0 where clamped)
+static inline size_t trilinear_offset(const size_t *lo, const size_t *hi, const size_t *stride, size_t *delta) {
+    for (int d = 0; d < 3; d++)
+        delta[d] = (hi[d] > lo[d]) ? stride[d] : 0;
+    return lo[0] * stride[0] + lo[1] * stride[1] + lo[2] * stride[2];
+}
+
+// Function to get the offset of corner q of a cell from its lower corner, the
+// bits of q selecting the upper corner along (k, i, j)
+static inline size_t trilinear_corner(int q, const size_t *delta) {
+    return ((q & 4) ? delta[0] : 0) + ((q & 2) ? delta[1] : 0) + ((q & 1) ? delta[2] : 0);
+}
+
+// Function to blend the values v of the eight corners of a cell (ordered as
+// in trilinear_corner) with the weights w
+static inline float trilinear(const float *v, const float *w) {
+    float v00 = v[0] + w[2] * (v[1] - v[0]), v01 = v[2] + w[2] * (v[3] - v[2]);
+    float v10 = v[4] + w[2] * (v[5] - v[4]), v11 = v[6] + w[2] * (v[7] - v[6]);
+    float v0 = v00 + w[1] * (v01 - v00), v1 = v10 + w[1] * (v11 - v10);
+    return v0 + w[0] * (v1 - v0);
+}
+
+// Defined with the 16-bit conversions below
+static inline float half_value(int precision, uint16_t h);
+
+// Function to get element e of a field stored as floats (PRECISION_FLOAT) or
+// in the 16-bit format precision
+static inline float field_value(int precision, const void *data, size_t e) {
+    if (precision == PRECISION_FLOAT)
+        return ((const float*) data)[e];
+    return half_value(precision, ((const uint16_t*) data)[e]);
+}
+
+// Function to interpolate nfields fields at position (z, y, x) inside a block
+// with the extents size into out, trilinear in space and, if data1 is not
+// NULL, linear in time with weight wt between data0 and data1. Element
+// (k, i, j) of field f is at f * field_stride + k * stride[0] + i * stride[1]
+// + j * stride[2], in the format precision
+static inline void trilinear_strided(int precision, const void *data0, const void *data1, float wt, int nfields,
+                                     size_t field_stride, const size_t *size, const size_t *stride, float z,
+                                     float y, float x, float *out) {
+    size_t lo[3], hi[3], delta[3];
+    float w[3];
+    trilinear_cell(z, y, x, size, lo, hi, w);
+    size_t o = trilinear_offset(lo, hi, stride, delta);
+    for (int f = 0; f < nfields; f++) {
+        float v[8];
+        for (int q = 0; q < 8; q++) {
+            size_t e = f * field_stride + o + trilinear_corner(q, delta);
+            v[q] = field_value(precision, data0, e);
+            if (data1 != NULL)
+                v[q] += wt * (field_value(precision, data1, e) - v[q]);
+        }
+        out[f] = trilinear(v, w);
+    }
+}
+
+// Function to time trilinear interpolation of nfields fields at npoints
+// random positions inside a block with the extents size (level, lat, lon).
+// Element (k, i, j) of field f is data[f * field_stride + k * stride[0] +
+// i * stride[1] + j * stride[2]], so the same positions can be probed in any
+// layout of the block. Returns seconds; *sum receives the sum of the results
+double interp_probe(const float *data, int nfields, size_t field_stride, const size_t *size,
+                    const size_t *stride, int npoints, unsigned seed, double *sum) {
+    float *pos = (float*) malloc(3 * (size_t) npoints * sizeof(float));
+    float *val = (float*) malloc(nfields * sizeof(float));
+    unsigned state = seed;
+    for (size_t p = 0; p < 3 * (size_t) npoints; p++)
+        pos[p] = uniform(&state) * (size[p % 3] - 1);
+    double acc = 0.0;
+    double t0 = get_time_sec();
+    for (int p = 0; p < npoints; p++) {
+        trilinear_strided(PRECISION_FLOAT, data, NULL, 0.0f, nfields, field_stride, size, stride, pos[3 * p],
+                          pos[3 * p + 1], pos[3 * p + 2], val);
+        for (int f = 0; f < nfields; f++)
+            acc += val[f];
+    }
+    double elapsed = get_time_sec() - t0;
+    free(pos);
+    free(val);
+    *sum = acc;
+    return elapsed;
+}
+
+// Function to apply the post-read transform to the subdomain of all data
+// variables, stored in fields b->bufsize floats apart, and store the result in
+// out. count holds the extents of the non-decomposed dimensions. With columns,
+// dimension col_idx of every piece becomes the fastest varying; with
+// interleave, the values of all variables at one grid point are stored next to
+// each other. work (of the same size) is only used if both are set
+void transform_subdomain(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                         const float *fields, float *out, float *work) {
+    size_t counts[NPIECES][MAX_DIMS], sizes[NPIECES];
+    size_t n = piece_counts(b, count, counts, sizes);
+    const float *src = fields;
+    if (columns) {
+        float *dst = interleave ? work : out;
+        for (int v = 0; v < b->nvars; v++) {
+            size_t off = (size_t) v * b->bufsize;
+            for (int p = 0; p < b->npieces; p++) {
+                transform_columns(b->ndims, counts[p], col_idx, src + off, dst + off);
+                off += sizes[p];
+            }
+        }
+        src = dst;
+    }
+    if (interleave)
+        transform_interleave(b->nvars, n, src, b->bufsize, out);
+}
+
+// Function to get the extents (level, lat, lon) of the interior piece and the
+// strides of its elements and variables as stored by transform_subdomain with
+// the same flags, with the dimension col_idx as vertical axis
+void subdomain_strides(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                       size_t *size, size_t *stride, size_t *field_stride) {
+    size_t counts[NPIECES][MAX_DIMS], sizes[NPIECES], dim_stride[MAX_DIMS];
+    int perm[MAX_DIMS], k = 0;
+    piece_counts(b, count, counts, sizes);
+    for (int d = 0; d < b->ndims; d++)
+        if (!columns || d != col_idx) perm[k++] = d;
+    if (columns) perm[k] = col_idx;
+    size_t n = 1;
+    for (k = b->ndims - 1; k >= 0; k--) {
+        dim_stride[perm[k]] = n;
+        n *= counts[PIECE_INTERIOR][perm[k]];
+    }
+    size[0] = counts[PIECE_INTERIOR][col_idx];
+    size[1] = counts[PIECE_INTERIOR][b->lat_idx];
+    size[2] = counts[PIECE_INTERIOR][b->lon_idx];
+    stride[0] = dim_stride[col_idx];
+    stride[1] = dim_stride[b->lat_idx];
+    stride[2] = dim_stride[b->lon_idx];
+    *field_stride = b->bufsize;
+    if (interleave) {
+        for (int d = 0; d < 3; d++)
+            stride[d] *= b->nvars;
+        *field_stride = 1;
+    }
+}
+
+// Function to probe interpolation in the interior piece of the subdomain as
+// stored by transform_subdomain with the same flags, with the dimension
+// col_idx as vertical axis. Returns seconds for npoints points
+double probe_subdomain(const bench_t *b, const size_t *count, int col_idx, int columns, int interleave,
+                       const float *data, int npoints, double *sum) {
+    size_t size[3], stride[3], field_stride;
+    subdomain_strides(b, count, col_idx, columns, interleave, size, stride, &field_stride);
+    return interp_probe(data, b->nvars, field_stride, size, stride, npoints, 12345u + b->rank, sum);
+}
+
+const char *layout_names[NLAYOUTS] = { "file", "columns", "interleave", "both", "tiled" };
+const char *particle_names[NPARTICLES] = { "random", "clustered", "sorted" };
+
+// Tile with its Morton code, for ordering the tiles
+typedef struct {
+    unsigned long long code;
+    size_t tile;
+} morton_tile_t;
+
+static int compare_morton(const void *a, const void *b) {
+    unsigned long long ca = ((const morton_tile_t*) a)->code, cb = ((const morton_tile_t*) b)->code;
+    return (ca > cb) - (ca < cb);
+}
+
+// Function to set up Morton-ordered tiles with the given edge (a power of
+// two) for the (level, lat, lon) block of the interior piece, with the
+// dimension col_idx as vertical axis
+void tiled_init(tiled_t *t, const bench_t *b, const size_t *count, int col_idx, int edge) {
+    size_t stride[3], field_stride;
+    subdomain_strides(b, count, col_idx, 0, 0, t->size, stride, &field_stride);
+    t->edge_shift = 0;
+    while ((1 << t->edge_shift) < edge)
+        t->edge_shift++;
+    size_t ntotal = 1;
+    for (int d = 0; d < 3; d++) {
+        t->ntiles[d] = (t->size[d] + ((size_t) 1 << t->edge_shift) - 1) >> t->edge_shift;
+        ntotal *= t->ntiles[d];
+    }
+    // Interleave the bits of the tile coordinates, level in the highest
+    morton_tile_t *order = (morton_tile_t*) malloc(ntotal * sizeof(morton_tile_t));
+    for (size_t tile = 0; tile < ntotal; tile++) {
+        size_t c[3] = { tile / (t->ntiles[1] * t->ntiles[2]), (tile / t->ntiles[2]) % t->ntiles[1],
+                        tile % t->ntiles[2] };
+        order[tile].code = 0;
+        order[tile].tile = tile;
+        for (int bit = 0; bit < 21; bit++)
+            for (int d = 0; d < 3; d++)
+                order[tile].code |= (unsigned long long) ((c[d] >> bit) & 1) << (3 * bit + 2 - d);
+    }
+    qsort(order, ntotal, sizeof(morton_tile_t), compare_morton);
+    t->slot = (size_t*) malloc(ntotal * sizeof(size_t));
+    for (size_t s = 0; s < ntotal; s++)
+        t->slot[order[s].tile] = s;
+    free(order);
+    t->n = ntotal << (3 * t->edge_shift);
+}
+
+// Function to free the tile order of tiled_init
+void tiled_free(tiled_t *t) {
+    free(t->slot);
+}
+
+// Function to copy the interior block of every variable in fields (as for
+// transform_subdomain) into its tiles, t->n floats per variable. Rows along
+// the longitude are copied whole when they are contiguous in the file layout
+void tile_subdomain(const tiled_t *t, const bench_t *b, const size_t *count, int col_idx,
+                    const float *fields, float *tiles) {
+    size_t size[3], stride[3], field_stride;
+    subdomain_strides(b, count, col_idx, 0, 0, size, stride, &field_stride);
+    size_t edge = (size_t) 1 << t->edge_shift;
+    for (int v = 0; v < b->nvars; v++) {
+        const float *src = fields + v * field_stride;
+        float *dst = tiles + v * t->n;
+        for (size_t k = 0; k < size[0]; k++)
+            for (size_t i = 0; i < size[1]; i++)
+                for (size_t j0 = 0; j0 < size[2]; j0 += edge) {
+                    size_t len = (size[2] - j0 < edge) ? size[2] - j0 : edge;
+                    const float *row = src + k * stride[0] + i * stride[1] + j0 * stride[2];
+                    float *out = dst + tiled_index(t, k, i, j0);
+                    if (stride[2] == 1)
+                        memcpy(out, row, len * sizeof(float));
+                    else
+                        for (size_t j = 0; j < len; j++)
+                            out[j] = row[j * stride[2]];
+                }
+    }
+}
+
+// Function to interpolate nfields fields at n particles in Morton tiles like
+// interp_particles. A particle whose stencil stays within one tile uses fixed
+// offsets, others look up the tile of every corner. Returns seconds
+double interp_tiled(const tiled_t *t, const float *tiles0, const float *tiles1, float wt, int nfields,
+                    const float *pos, size_t n, float *out) {
+    double t0 = get_time_sec();
+    size_t m = ((size_t) 1 << t->edge_shift) - 1;
+#pragma omp parallel for schedule(static)
+    for (size_t p = 0; p < n; p++) {
+        size_t lo[3], hi[3], c[8];
+        float w[3];
+        trilinear_cell(pos[p], pos[n + p], pos[2 * n + p], t->size, lo, hi, w);
+        if ((lo[0] & m) < m && (lo[1] & m) < m && (lo[2] & m) < m) {
+            size_t base = tiled_index(t, lo[0], lo[1], lo[2]), delta[3];
+            size_t stride[3] = { (size_t) 1 << (2 * t->edge_shift), (size_t) 1 << t->edge_shift, 1 };
+            trilinear_offset(lo, hi, stride, delta);
+            for (int q = 0; q < 8; q++)
+                c[q] = base + trilinear_corner(q, delta);
+        } else {
+            for (int q = 0; q < 8; q++)
+                c[q] = tiled_index(t, (q & 4) ? hi[0] : lo[0], (q & 2) ? hi[1] : lo[1], (q & 1) ? hi[2] : lo[2]);
+        }
+        for (int f = 0; f < nfields; f++) {
+            const float *a = tiles0 + f * t->n, *b = tiles1 + f * t->n;
+            float v[8];
+            for (int q = 0; q < 8; q++)
+                v[q] = a[c[q]] + wt * (b[c[q]] - a[c[q]]);
+            out[p * nfields + f] = trilinear(v, w);
+        }
+    }
+    return get_time_sec() - t0;
+}
+
+// Function to compute TLB-miss proxies of interpolating one field at n
+// particles, addressed with strides (t == NULL) or in the tiles of t: the mean
+// number of distinct 4 KiB pages among the eight corners of a particle, and
+// the mean number of page changes per particle when the corners of
+// consecutive particles are visited in order
+void page_proxies(const tiled_t *t, const size_t *size, const size_t *stride, const float *pos, size_t n,
+                  double *pages, double *switches) {
+    const size_t page_floats = 4096 / sizeof(float);
+    size_t last = (size_t) -1, npages = 0, nswitches = 0;
+    for (size_t p = 0; p < n; p++) {
+        size_t c[3] = { (size_t) pos[p], (size_t) pos[n + p], (size_t) pos[2 * n + p] };
+        size_t page[8];
+        int distinct = 0;
+        for (int q = 0; q < 8; q++) {
+            size_t k = c[0] + ((q >> 2) & 1), i = c[1] + ((q >> 1) & 1), j = c[2] + (q & 1);
+            if (k >= size[0]) k = size[0] - 1;
+            if (i >= size[1]) i = size[1] - 1;
+            if (j >= size[2]) j = size[2] - 1;
+            size_t index = t ? tiled_index(t, k, i, j) : k * stride[0] + i * stride[1] + j * stride[2];
+            page[q] = index / page_floats;
+            int seen = 0;
+            for (int r = 0; r < q; r++)
+                if (page[r] == page[q]) seen = 1;
+            distinct += !seen;
+            if (page[q] != last) nswitches++;
+            last = page[q];
+        }
+        npages += distinct;
+    }
+    *pages = (double) npages / n;
+    *switches = (double) nswitches / n;
+}
+
+// Particle with the horizontal grid cell it is sorted by
+typedef struct {
+    size_t cell;
+    float k, y, x;
+} sort_particle_t;
+
+static int compare_particle(const void *a, const void *b) {
+    size_t ca = ((const sort_particle_t*) a)->cell, cb = ((const sort_particle_t*) b)->cell;
+    return (ca > cb) - (ca < cb);
+}
+
+// Function to place n particles in the part of the interior piece the rank
+// owns, without its halo, at positions in grid index space stored as three
+// arrays (level, lat, lon) in pos. Random particles are spread uniformly,
+// clustered ones around eight random centres, and sorted ones are random
+// particles sorted by horizontal grid cell, as a model would after binning
+void make_particles(const bench_t *b, const size_t *count, int col_idx, int dist, size_t n, float *pos) {
+    size_t size[3], stride[3], field_stride;
+    subdomain_strides(b, count, col_idx, 0, 0, size, stride, &field_stride);
+    int px = b->rank % b->nproc_x;
+    int py = (b->rank / b->nproc_x) % b->nproc_y;
+    size_t sub_lat = b->dimlen[b->lat_idx] / b->nproc_y, sub_lon = b->dimlen[b->lon_idx] / b->nproc_x;
+    float lo[3], hi[3];
+    lo[0] = 0.0f;
+    hi[0] = (float) (size[0] - 1);
+    lo[1] = (float) (py * sub_lat - b->pieces[PIECE_INTERIOR].lat0);
+    hi[1] = lo[1] + sub_lat;
+    lo[2] = (float) (px * sub_lon - b->pieces[PIECE_INTERIOR].lon0);
+    hi[2] = lo[2] + sub_lon;
+    // A particle in the last owned cell needs the halo for its upper neighbour
+    for (int d = 1; d < 3; d++)
+        if (hi[d] > (float) (size[d] - 1)) hi[d] = (float) (size[d] - 1);
+    unsigned state = 4321u + b->rank;
+    float centre[8][3];
+    for (int c = 0; c < 8; c++)
+        for (int d = 0; d < 3; d++)
+            centre[c][d] = lo[d] + uniform(&state) * (hi[d] - lo[d]);
+    for (size_t p = 0; p < n; p++) {
+        int c = (int) (uniform(&state) * 8.0f) & 7;
+        for (int d = 0; d < 3; d++) {
+            float x;
+            if (dist == PARTICLES_CLUSTERED) {
+                // Sum of three uniforms, spread over 2 % of the extent
+                float spread = 0.02f * (hi[d] - lo[d]) + 1.0f;
+                x = centre[c][d] + (uniform(&state) + uniform(&state) + uniform(&state) - 1.5f) * spread;
+                x = (x < lo[d]) ? lo[d] : (x > hi[d]) ? hi[d] : x;
+            } else {
+                x = lo[d] + uniform(&state) * (hi[d] - lo[d]);
+            }
+            pos[d * n + p] = x;
+        }
+    }
+    if (dist == PARTICLES_SORTED) {
+        sort_particle_t *sp = (sort_particle_t*) malloc(n * sizeof(sort_particle_t));
+        for (size_t p = 0; p < n; p++) {
+            sp[p].k = pos[p];
+            sp[p].y = pos[n + p];
+            sp[p].x = pos[2 * n + p];
+            sp[p].cell = (size_t) sp[p].y * size[2] + (size_t) sp[p].x;
+        }
+        qsort(sp, n, sizeof(sort_particle_t), compare_particle);
+        for (size_t p = 0; p < n; p++) {
+            pos[p] = sp[p].k;
+            pos[n + p] = sp[p].y;
+            pos[2 * n + p] = sp[p].x;
+        }
+        free(sp);
+    }
+}
+
+// Function to interpolate nfields fields at n particles, trilinear in space
+// and linear in time with weight wt between data0 and data1. Addressing as in
+// interp_probe, positions as from make_particles; the results go to out with
+// the fields of one particle next to each other. The particles are shared
+// among the OpenMP threads and vectorised. Returns seconds
+double interp_particles(const float *data0, const float *data1, float wt, int nfields, size_t field_stride,
+                        const size_t *size, const size_t *stride, const float *pos, size_t n, float *out) {
+    double t0 = get_time_sec();
+#pragma omp parallel for simd schedule(static)
+    for (size_t p = 0; p < n; p++)
+        trilinear_strided(PRECISION_FLOAT, data0, data1, wt, nfields, field_stride, size, stride, pos[p],
+                          pos[n + p], pos[2 * n + p], out + p * nfields);
+    return get_time_sec() - t0;
+}
+
+// Function to time the interpolation of n particles between two time levels
+// of the subdomain, fields0 and fields1 (as for transform_subdomain), in every
+// layout the post-read transform produces. out0, out1 and work hold the
+// transformed time levels, result the interpolated values; times[l] receives
+// the seconds of layout l. If tiled is not NULL, the time levels are also
+// tiled into tiles0 and tiles1, taking *tile_time seconds, and interpolated
+// in the tiles
+void bench_interp(const bench_t *b, const size_t *count, int col_idx, const float *fields0, const float *fields1,
+                  const float *pos, size_t n, float *out0, float *out1, float *work, float *result,
+                  const tiled_t *tiled, float *tiles0, float *tiles1, double *tile_time, double *times) {
+    times[LAYOUT_TILED] = 0.0;
+    *tile_time = 0.0;
+    if (tiled != NULL) {
+        double t0 = get_time_sec();
+        tile_subdomain(tiled, b, count, col_idx, fields0, tiles0);
+        tile_subdomain(tiled, b, count, col_idx, fields1, tiles1);
+        *tile_time = get_time_sec() - t0;
+        times[LAYOUT_TILED] = interp_tiled(tiled, tiles0, tiles1, 0.25f, b->nvars, pos, n, result);
+    }
+    for (int l = 0; l < LAYOUT_TILED; l++) {
+        int columns = (l & LAYOUT_COLUMNS) != 0, interleave = (l & LAYOUT_INTERLEAVE) != 0;
+        const float *data0 = fields0, *data1 = fields1;
+        if (l != LAYOUT_FILE) {
+            transform_subdomain(b, count, col_idx, columns, interleave, fields0, out0, work);
+            transform_subdomain(b, count, col_idx, columns, interleave, fields1, out1, work);
+            data0 = out0;
+            data1 = out1;
+        }
+        size_t size[3], stride[3], field_stride;
+        subdomain_strides(b, count, col_idx, columns, interleave, size, stride, &field_stride);
+        times[l] = interp_particles(data0, data1, 0.25f, b->nvars, field_stride, size, stride, pos, n, result);
+    }
+}
+
+// Function to round a float to the nearest fp16 value (ties to even).
+// Values beyond the fp16 range become infinity, NaN stays NaN
+static uint16_t fp16_from_float(float v) {
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000u;
+    x &= 0x7fffffffu;
+    if (x >= 0x47800000u)  // 65536 and beyond, infinity and NaN
+        return (uint16_t) (sign | (x > 0x7f800000u ? 0x7e00u : 0x7c00u));
+    if (x < 0x38800000u) {
+        // Below 2^-14 the result is subnormal: adding 0.5 rounds the value to
+        // a multiple of 2^-24, which lands in the low mantissa bits
+        float a;
+        memcpy(&a, &x, sizeof(a));
+        a += 0.5f;
+        memcpy(&x, &a, sizeof(x));
+        return (uint16_t) (sign | (x - 0x3f000000u));
+    }
+    // Rebias the exponent and round the 13 dropped mantissa bits
+    x += 0xc8000fffu + ((x >> 13) & 1u);
+    return (uint16_t) (sign | (x >> 13));
+}
+
+// Function to widen an fp16 value to float
+static float fp16_to_float(uint16_t h) {
+    uint32_t x = ((uint32_t) h & 0x7fffu) << 13;
+    uint32_t exponent = x & 0x0f800000u;
+    x += 0x38000000u;  // Rebias the exponent from 15 to 127
+    if (exponent == 0x0f800000u) {
+        x += 0x38000000u;  // Infinity and NaN
+    } else if (exponent == 0) {
+        // Subnormal: renormalise through the float unit
+        float v;
+        x += 0x00800000u;
+        memcpy(&v, &x, sizeof(v));
+        v -= 6.103515625e-05f;  // 2^-14
+        memcpy(&x, &v, sizeof(x));
+    }
+    x |= ((uint32_t) h & 0x8000u) << 16;
+    float v;
+    memcpy(&v, &x, sizeof(v));
+    return v;
+}
+
+// Function to round a float to the nearest bfloat16 value (ties to even),
+// the upper half of the float with a quiet NaN kept quiet
+static uint16_t bf16_from_float(float v) {
+    uint32_t x;
+    memcpy(&x, &v, sizeof(x));
+    if ((x & 0x7fffffffu) > 0x7f800000u)
+        return (uint16_t) ((x >> 16) | 0x40u);
+    return (uint16_t) ((x + 0x7fffu + ((x >> 16) & 1u)) >> 16);
+}
+
+// Function to widen a bfloat16 value to float
+static inline float bf16_to_float(uint16_t h) {
+    uint32_t x = (uint32_t) h << 16;
+    float v;
+    memcpy(&v, &x, sizeof(v));
+    return v;
+}
+
+const char *precision_names[NPRECISIONS] = { "float", "fp16", "bf16" };
+
+// Function to convert n floats of src to the 16-bit format precision in dst.
+// Uses AVX-512 and F16C for fp16, AVX-512 BF16 or AVX2 for bfloat16, and the
+// scalar conversion for the remainder
+void encode_half(int precision, const float *src, uint16_t *dst, size_t n) {
+    size_t i = 0;
+    if (precision == PRECISION_FP16) {
+#ifdef __AVX512F__
+        for (; i + 16 <= n; i += 16)
+            _mm256_storeu_si256((__m256i*) (dst + i),
+                                _mm512_cvtps_ph(_mm512_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm_storeu_si128((__m128i*) (dst + i),
+                             _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+#endif
+        for (; i < n; i++)
+            dst[i] = fp16_from_float(src[i]);
+    } else {
+#ifdef __AVX512BF16__
+        for (; i + 16 <= n; i += 16)
+            _mm256_storeu_si256((__m256i*) (dst + i), (__m256i) _mm512_cvtneps_pbh(_mm512_loadu_ps(src + i)));
+#endif
+#ifdef __AVX2__
+        const __m256i one = _mm256_set1_epi32(1), bias = _mm256_set1_epi32(0x7fff);
+        const __m256i quiet = _mm256_set1_epi32(0x40);
+        for (; i + 8 <= n; i += 8) {
+            __m256 v = _mm256_loadu_ps(src + i);
+            __m256i x = _mm256_castps_si256(v);
+            __m256i odd = _mm256_and_si256(_mm256_srli_epi32(x, 16), one);
+            __m256i r = _mm256_srli_epi32(_mm256_add_epi32(x, _mm256_add_epi32(bias, odd)), 16);
+            __m256i nan = _mm256_or_si256(_mm256_srli_epi32(x, 16), quiet);
+            r = _mm256_blendv_epi8(r, nan, _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)));
+            // Pack the 32-bit results to 16 bits and gather both lanes
+            r = _mm256_permute4x64_epi64(_mm256_packus_epi32(r, r), 0xd8);
+            _mm_storeu_si128((__m128i*) (dst + i), _mm256_castsi256_si128(r));
+        }
+#endif
+        for (; i < n; i++)
+            dst[i] = bf16_from_float(src[i]);
+    }
+}
+
+// Function to convert n values of the 16-bit format precision in src back
+// to floats in dst, vectorised as encode_half
+void decode_half(int precision, const uint16_t *src, float *dst, size_t n) {
+    size_t i = 0;
+    if (precision == PRECISION_FP16) {
+#ifdef __AVX512F__
+        for (; i + 16 <= n; i += 16)
+            _mm512_storeu_ps(dst + i, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*) (src + i))));
+#endif
+#ifdef __F16C__
+        for (; i + 8 <= n; i += 8)
+            _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*) (src + i))));
+#endif
+        for (; i < n; i++)
+            dst[i] = fp16_to_float(src[i]);
+    } else {
+#ifdef __AVX2__
+        for (; i + 8 <= n; i += 8) {
+            __m256i x = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*) (src + i)));
+            _mm256_storeu_ps(dst + i, _mm256_castsi256_ps(_mm256_slli_epi32(x, 16)));
+        }
+#endif
+        for (; i < n; i++)
+            dst[i] = bf16_to_float(src[i]);
+    }
+}
+
+// Function to widen one stored 16-bit value in the interpolation kernel
+static inline float half_value(int precision, uint16_t h) {
+    if (precision == PRECISION_BF16)
+        return bf16_to_float(h);
+#ifdef __F16C__
+    return _cvtsh_ss(h);
+#else
+    return fp16_to_float(h);
+#endif
+}
+
+// Function to interpolate as interp_particles from fields stored in the
+// 16-bit format precision, widening the eight corners of both time levels
+// in registers. Returns seconds
+double interp_half(int precision, const uint16_t *data0, const uint16_t *data1, float wt, int nfields,
+                   size_t field_stride, const size_t *size, const size_t *stride, const float *pos, size_t n,
+                   float *out) {
+    double t0 = get_time_sec();
+#pragma omp parallel for simd schedule(static)
+    for (size_t p = 0; p < n; p++)
+        trilinear_strided(precision, data0, data1, wt, nfields, field_stride, size, stride, pos[p], pos[n + p],
+                          pos[2 * n + p], out + p * nfields);
+    return get_time_sec() - t0;
+}
+
+// Function to get the largest error of val against ref over nvars variables
+// of n values each, variable v at offset v * var_stride with step between
+// values, relative to the largest magnitude of the variable. Values that
+// are finite in ref but not in val are skipped and counted in *overflows
+static double half_error(const float *ref, const float *val, int nvars, size_t n, size_t var_stride,
+                         size_t step, size_t *overflows) {
+    double err = 0.0;
+    for (int v = 0; v < nvars; v++) {
+        double max_diff = 0.0, max_ref = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            float r = ref[v * var_stride + i * step], x = val[v * var_stride + i * step];
+            if (!isfinite(r)) continue;
+            if (!isfinite(x)) {
+                (*overflows)++;
+                continue;
+            }
+            if (fabs(r) > max_ref) max_ref = fabs(r);
+            if (fabs(x - r) > max_diff) max_diff = fabs(x - r);
+        }
+        if (max_ref > 0.0 && max_diff / max_ref > err) err = max_diff / max_ref;
+    }
+    return err;
+}
+
+// Function to keep the subdomain fields (as for transform_subdomain) in the
+// 16-bit format precision: encodes them into half1, decodes them into work
+// and interpolates the n particles between half0 and half1 as bench_interp
+// does in the file layout. ref holds the float results of bench_interp and
+// result receives the half ones. times receives the seconds of encoding,
+// decoding and interpolation, errors and overflows the largest relative
+// error and the number of values that exceed the format, for the decoded
+// fields and for the interpolated values
+void bench_half(int precision, const bench_t *b, const size_t *count, int col_idx, const float *fields,
+                const uint16_t *half0, uint16_t *half1, const float *pos, size_t n, const float *ref,
+                float *result, float *work, double *times, double *errors, size_t *overflows) {
+    size_t counts[NPIECES][MAX_DIMS], sizes[NPIECES];
+    size_t nv = piece_counts(b, count, counts, sizes);
+    double t0 = get_time_sec();
+    for (int v = 0; v < b->nvars; v++)
+        encode_half(precision, fields + v * b->bufsize, half1 + v * b->bufsize, nv);
+    double t1 = get_time_sec();
+    for (int v = 0; v < b->nvars; v++)
+        decode_half(precision, half1 + v * b->bufsize, work + v * b->bufsize, nv);
+    times[0] = t1 - t0;
+    times[1] = get_time_sec() - t1;
+    size_t size[3], stride[3], field_stride;
+    subdomain_strides(b, count, col_idx, 0, 0, size, stride, &field_stride);
+    times[2] = interp_half(precision, half0, half1, 0.25f, b->nvars, field_stride, size, stride, pos, n, result);
+    overflows[0] = overflows[1] = 0;
+    errors[0] = half_error(fields, work, b->nvars, nv, b->bufsize, 1, &overflows[0]);
+    errors[1] = half_error(ref, result, b->nvars, n, 1, b->nvars, &overflows[1]);
+}
+
+// Codecs of the compressed tile store. Both compress the byte planes of the
+// floats of a tile (all first bytes, then all second bytes, ...), which puts
+// the slowly varying sign and exponent bytes next to each other
+#ifdef HAVE_LZ4
+const char *codec_names[NCODECS] = { "shuffle-lz", "lz4" };
+#else
+const char *codec_names[NCODECS] = { "shuffle-lz", NULL };
+#endif
+
+// Function to append one sequence of the built-in LZ format to dst at op:
+// a token with the literal count and match length (minus 4) in its nibbles,
+// extended by bytes of 255 when a nibble is 15, the literals, then the match
+// offset as 2 bytes and the extended match length. The last sequence of a
+// block has no match. Returns the new end of dst
+static size_t lz_sequence(unsigned char *dst, size_t op, const unsigned char *lit, size_t nlit,
+                          size_t offset, size_t len) {
+    size_t token = op++;
+    size_t l = nlit, m = len ? len - 4 : 0;
+    dst[token] = (unsigned char) (((l < 15 ? l : 15) << 4) | (m < 15 ? m : 15));
+    if (l >= 15) {
+        for (l -= 15; l >= 255; l -= 255)
+            dst[op++] = 255;
+        dst[op++] = (unsigned char) l;
+    }
+    memcpy(dst + op, lit, nlit);
+    op += nlit;
+    if (len == 0)
+        return op;
+    dst[op++] = (unsigned char) (offset & 0xff);
+    dst[op++] = (unsigned char) (offset >> 8);
+    if (m >= 15) {
+        for (m -= 15; m >= 255; m -= 255)
+            dst[op++] = 255;
+        dst[op++] = (unsigned char) m;
+    }
+    return op;
+}
+
+// Function to get the largest compressed size of n bytes in the built-in
+// LZ format, all literals
+static size_t lz_bound(size_t n) {
+    return n + n / 255 + 16;
+}
+
+// Function to compress n bytes of src into dst with the built-in LZ format,
+// finding matches of at least 4 bytes within 64 KiB through a hash table of
+// recent positions. dst needs lz_bound(n) bytes. Returns the compressed size
+static size_t lz_compress(const unsigned char *src, size_t n, unsigned char *dst) {
+    enum { HASH_BITS = 12 };
+    uint32_t table[1 << HASH_BITS] = {0};  // Position + 1 of the last 4 bytes with this hash
+    size_t ip = 0, anchor = 0, op = 0;
+    while (ip + 4 <= n) {
+        uint32_t seq;
+        memcpy(&seq, src + ip, 4);
+        uint32_t h = (seq * 2654435761u) >> (32 - HASH_BITS);
+        size_t cand = table[h];
+        table[h] = (uint32_t) (ip + 1);
+        if (cand > 0 && ip - (cand - 1) <= 65535 && memcmp(src + cand - 1, src + ip, 4) == 0) {
+            size_t ref = cand - 1, len = 4;
+            while (ip + len < n && src[ref + len] == src[ip + len])
+                len++;
+            op = lz_sequence(dst, op, src + anchor, ip - anchor, ip - ref, len);
+            ip += len;
+            anchor = ip;
+        } else {
+            ip++;
+        }
+    }
+    return lz_sequence(dst, op, src + anchor, n - anchor, 0, 0);
+}
+
+// Function to decompress n bytes of the built-in LZ format from src into
+// dst of cap bytes. Short literal runs and matches are copied in whole 16
+// and 8 byte words while they stay inside src and dst. Returns the
+// decompressed size
+static size_t lz_decompress(const unsigned char *src, size_t n, unsigned char *dst, size_t cap) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        unsigned token = src[ip++];
+        size_t nlit = token >> 4, len = (token & 15) + 4;
+        if (nlit == 15) {
+            unsigned char b;
+            do {
+                b = src[ip++];
+                nlit += b;
+            } while (b == 255);
+        }
+        if (nlit <= 16 && ip + 16 <= n && op + 16 <= cap)
+            memcpy(dst + op, src + ip, 16);
+        else
+            memcpy(dst + op, src + ip, nlit);
+        ip += nlit;
+        op += nlit;
+        if (ip >= n)
+            break;
+        size_t offset = src[ip] | ((size_t) src[ip + 1] << 8);
+        ip += 2;
+        if ((token & 15) == 15) {
+            unsigned char b;
+            do {
+                b = src[ip++];
+                len += b;
+            } while (b == 255);
+        }
+        // A match that overlaps its own output repeats its first offset
+        // bytes, copied in chunks that double with every step
+        if (offset >= 8 && op + len + 8 <= cap) {
+            for (size_t k = 0; k < len; k += 8)
+                memcpy(dst + op + k, dst + op - offset + k, 8);
+        } else if (offset >= len) {
+            memcpy(dst + op, dst + op - offset, len);
+        } else {
+            memcpy(dst + op, dst + op - offset, offset);
+            for (size_t done = offset; done < len;) {
+                size_t chunk = (len - done < done) ? len - done : done;
+                memcpy(dst + op + done, dst + op, chunk);
+                done += chunk;
+            }
+        }
+        op += len;
+    }
+    return op;
+}
+
+// Function to set up an empty store for the tiles of nvars variables with
+// the geometry of t, compressed with codec, and an LRU of cache_tiles
+// decompressed tiles
+void store_init(store_t *s, const tiled_t *t, int nvars, int codec, int cache_tiles) {
+    s->tiled = t;
+    s->codec = codec;
+    s->nvars = nvars;
+    s->tile_size = (size_t) 1 << (3 * t->edge_shift);
+    s->ntiles = t->n / s->tile_size;
+    size_t total = (size_t) nvars * s->ntiles;
+    s->data = (unsigned char**) calloc(total, sizeof(unsigned char*));
+    s->bytes = (size_t*) calloc(total, sizeof(size_t));
+    s->stored_bytes = 0;
+    size_t raw = s->tile_size * sizeof(float);
+    size_t bound = lz_bound(raw);
+#ifdef HAVE_LZ4
+    if ((size_t) LZ4_compressBound((int) raw) > bound)
+        bound = (size_t) LZ4_compressBound((int) raw);
+#endif
+    s->scratch = (unsigned char*) malloc(raw + bound);
+    s->cache_tiles = cache_tiles;
+    s->cache = (float*) malloc((size_t) cache_tiles * s->tile_size * sizeof(float));
+    s->cache_key = (size_t*) malloc((size_t) cache_tiles * sizeof(size_t));
+    s->cache_used = (unsigned long*) calloc(cache_tiles, sizeof(unsigned long));
+    s->where = (int*) malloc(total * sizeof(int));
+    for (size_t k = 0; k < total; k++)
+        s->where[k] = -1;
+    for (int e = 0; e < cache_tiles; e++)
+        s->cache_key[e] = total;
+    s->tick = s->hits = s->misses = 0;
+}
+
+// Function to release the tiles and the LRU of a store
+void store_free(store_t *s) {
+    for (size_t k = 0; k < (size_t) s->nvars * s->ntiles; k++)
+        free(s->data[k]);
+    free(s->data);
+    free(s->bytes);
+    free(s->scratch);
+    free(s->cache);
+    free(s->cache_key);
+    free(s->cache_used);
+    free(s->where);
+}
+
+// Function to decompress tile k of a store into dst
+static void store_decompress(store_t *s, size_t k, float *dst) {
+    size_t raw = s->tile_size * sizeof(float);
+    const unsigned char *planes = s->data[k];
+    if (s->bytes[k] < raw) {
+        planes = s->scratch;
+#ifdef HAVE_LZ4
+        if (s->codec == CODEC_LZ4)
+            LZ4_decompress_safe((const char*) s->data[k], (char*) s->scratch, (int) s->bytes[k], (int) raw);
+        else
+#endif
+            lz_decompress(s->data[k], s->bytes[k], s->scratch, raw);
+    }
+    // Gather the byte planes back into floats
+    unsigned char *out = (unsigned char*) dst;
+    for (size_t i = 0; i < s->tile_size; i++)
+        for (size_t b = 0; b < sizeof(float); b++)
+            out[i * sizeof(float) + b] = planes[b * s->tile_size + i];
+}
+
+// Function to replace the content of a store with the tiles of all
+// variables, as from tile_subdomain, and empty its LRU. Tiles that do not
+// shrink are kept as byte planes. Returns seconds
+double store_put(store_t *s, const float *tiles) {
+    double t0 = get_time_sec();
+    size_t raw = s->tile_size * sizeof(float);
+    unsigned char *planes = s->scratch, *packed = s->scratch + raw;
+    s->stored_bytes = 0;
+    for (int v = 0; v < s->nvars; v++) {
+        for (size_t t = 0; t < s->ntiles; t++) {
+            size_t k = (size_t) v * s->ntiles + t;
+            const unsigned char *in = (const unsigned char*) (tiles + v * s->tiled->n + t * s->tile_size);
+            for (size_t b = 0; b < sizeof(float); b++)
+                for (size_t i = 0; i < s->tile_size; i++)
+                    planes[b * s->tile_size + i] = in[i * sizeof(float) + b];
+            size_t bytes;
+#ifdef HAVE_LZ4
+            if (s->codec == CODEC_LZ4)
+                bytes = (size_t) LZ4_compress_default((const char*) planes, (char*) packed, (int) raw,
+                                                      LZ4_compressBound((int) raw));
+            else
+#endif
+                bytes = lz_compress(planes, raw, packed);
+            const unsigned char *keep = packed;
+            if (bytes == 0 || bytes >= raw) {
+                bytes = raw;
+                keep = planes;
+            }
+            free(s->data[k]);
+            s->data[k] = (unsigned char*) malloc(bytes);
+            memcpy(s->data[k], keep, bytes);
+            s->bytes[k] = bytes;
+            s->stored_bytes += bytes;
+        }
+    }
+    for (int e = 0; e < s->cache_tiles; e++) {
+        if (s->cache_key[e] < (size_t) s->nvars * s->ntiles)
+            s->where[s->cache_key[e]] = -1;
+        s->cache_key[e] = (size_t) s->nvars * s->ntiles;
+        s->cache_used[e] = 0;
+    }
+    s->tick = s->hits = s->misses = 0;
+    return get_time_sec() - t0;
+}
+
+// Function to get tile t of variable v from a store: from the LRU if it
+// holds the tile, else decompressed into the least recently used entry
+const float *store_tile(store_t *s, int v, size_t t) {
+    size_t k = (size_t) v * s->ntiles + t;
+    int e = s->where[k];
+    s->tick++;
+    if (e >= 0) {
+        s->hits++;
+    } else {
+        s->misses++;
+        e = 0;
+        for (int c = 1; c < s->cache_tiles; c++)
+            if (s->cache_used[c] < s->cache_used[e]) e = c;
+        if (s->cache_key[e] < (size_t) s->nvars * s->ntiles)
+            s->where[s->cache_key[e]] = -1;
+        store_decompress(s, k, s->cache + (size_t) e * s->tile_size);
+        s->cache_key[e] = k;
+        s->where[k] = e;
+    }
+    s->cache_used[e] = s->tick;
+    return s->cache + (size_t) e * s->tile_size;
+}
+
+// Function to time the decompression of every tile of a store. Returns
+// the mean seconds per tile
+double store_latency(store_t *s) {
+    float *tile = (float*) malloc(s->tile_size * sizeof(float));
+    size_t total = (size_t) s->nvars * s->ntiles;
+    double t0 = get_time_sec();
+    for (size_t k = 0; k < total; k++)
+        store_decompress(s, k, tile);
+    double seconds = get_time_sec() - t0;
+    free(tile);
+    return seconds / total;
+}
+
+// Function to interpolate trilinearly at n particles (positions as from
+// make_particles) in one time level of all variables, reading the corners
+// through the LRU of the store if tiles is NULL and from the uncompressed
+// tiles otherwise. Runs on one thread, so that both access paths compare
+// directly. Returns seconds
+double store_interp(store_t *s, const float *tiles, const float *pos, size_t n, float *out) {
+    const tiled_t *t = s->tiled;
+    size_t mask = s->tile_size - 1;
+    int shift = 3 * t->edge_shift;
+    double t0 = get_time_sec();
+    for (size_t p = 0; p < n; p++) {
+        size_t lo[3], hi[3], corner[8];
+        float w[3];
+        trilinear_cell(pos[p], pos[n + p], pos[2 * n + p], t->size, lo, hi, w);
+        for (int q = 0; q < 8; q++)
+            corner[q] = tiled_index(t, (q & 4) ? hi[0] : lo[0], (q & 2) ? hi[1] : lo[1], (q & 1) ? hi[2] : lo[2]);
+        for (int f = 0; f < s->nvars; f++) {
+            float v[8];
+            for (int q = 0; q < 8; q++) {
+                if (tiles != NULL)
+                    v[q] = tiles[f * t->n + corner[q]];
+                else
+                    v[q] = store_tile(s, f, corner[q] >> shift)[corner[q] & mask];
+            }
+            out[p * s->nvars + f] = trilinear(v, w);
+        }
+    }
+    return get_time_sec() - t0;
+}
+
+// Header of one step in a delta cache file, followed by bytes of payload
+typedef struct {
+    uint32_t kind;      // 0 for a keyframe, 1 for a delta
+    uint32_t checksum;  // Of the reconstructed step
+    uint64_t bytes;     // Payload: compressed byte planes, or the planes if they do not shrink
+} delta_record_t;
+
+// Function to open the rank-local delta cache at path for writing (writer
+// != 0) or reading, for steps of nvars variables of n floats each, stored
+// stride floats apart in the caller's buffers. Every keyframe-th step is a
+// keyframe; deltas are quantised with step quant, or exact (XOR of the
+// float bits) if quant is 0
+void delta_open(delta_cache_t *dc, const char *path, int writer, int nvars, size_t n, size_t stride,
+                int keyframe, float quant) {
+    dc->fd = writer ? open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : open(path, O_RDONLY);
+    if (dc->fd < 0) {
+        printf("Error opening delta cache %s for %s\n", path, writer ? "writing" : "reading");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    if (!writer)
+        posix_fadvise(dc->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    dc->writer = writer;
+    dc->keyframe = keyframe;
+    dc->quant = quant;
+    dc->nvars = nvars;
+    dc->n = n;
+    dc->stride = stride;
+    dc->step = 0;
+    // Fill the buffers once with a non-zero pattern, which the compiler
+    // cannot turn into calloc, so that the first step does not time page
+    // faults. The first step is a keyframe, so recon needs no zeros
+    size_t total = (size_t) nvars * n, bound = lz_bound(total * sizeof(uint32_t));
+    dc->recon = (float*) malloc(total * sizeof(float));
+    dc->words = (uint32_t*) malloc(total * sizeof(uint32_t));
+    dc->planes = (unsigned char*) malloc(total * sizeof(uint32_t));
+    dc->packed = (unsigned char*) malloc(bound);
+    memset(dc->recon, 0xff, total * sizeof(float));
+    memset(dc->words, 0xff, total * sizeof(uint32_t));
+    memset(dc->planes, 0xff, total * sizeof(uint32_t));
+    memset(dc->packed, 0xff, bound);
+}
+
+// Function to flush and close a delta cache. A written cache is dropped
+// from the page cache, so that reading it back goes to the file system
+void delta_close(delta_cache_t *dc) {
+    if (dc->writer) {
+        fsync(dc->fd);
+        posix_fadvise(dc->fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    close(dc->fd);
+    free(dc->recon);
+    free(dc->words);
+    free(dc->planes);
+    free(dc->packed);
+}
+
+// Function to apply n words w of one step to the reconstructed previous
+// step: a keyframe replaces it, an exact delta flips its bits, and a
+// quantised delta adds its multiple of quant. Shared by writer and reader,
+// so that both reconstruct bit-identical steps
+static void delta_apply(const delta_cache_t *dc, int keyframe, const uint32_t *w, float *recon, size_t total) {
+    if (keyframe) {
+        memcpy(recon, w, total * sizeof(float));
+    } else if (dc->quant == 0.0f) {
+        for (size_t i = 0; i < total; i++) {
+            uint32_t x;
+            memcpy(&x, &recon[i], sizeof(x));
+            x ^= w[i];
+            memcpy(&recon[i], &x, sizeof(x));
+        }
+    } else {
+        float q = dc->quant;
+        for (size_t i = 0; i < total; i++)
+            recon[i] += q * (float) (int32_t) w[i];
+    }
+}
+
+// Function to get the checksum of a reconstructed step
+static uint32_t delta_checksum(const float *recon, size_t total) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < total; i++) {
+        uint32_t x;
+        memcpy(&x, &recon[i], sizeof(x));
+        h = (h ^ x) * 16777619u;
+    }
+    return h;
+}
+
+// Function to append the next step of all variables in fields to a delta
+// cache, as a keyframe or as the delta to the step the reader reconstructs
+// before it. *error receives the largest absolute difference between fields
+// and the reconstruction. Returns the bytes written
+size_t delta_write(delta_cache_t *dc, const float *fields, double *error) {
+    size_t total = (size_t) dc->nvars * dc->n, raw = total * sizeof(uint32_t);
+    int keyframe = dc->step % dc->keyframe == 0;
+    for (int v = 0; v < dc->nvars; v++) {
+        const float *x = fields + v * dc->stride;
+        const float *r = dc->recon + v * dc->n;
+        uint32_t *w = dc->words + v * dc->n;
+        if (keyframe) {
+            memcpy(w, x, dc->n * sizeof(float));
+        } else if (dc->quant == 0.0f) {
+            for (size_t i = 0; i < dc->n; i++) {
+                uint32_t a, b;
+                memcpy(&a, &x[i], sizeof(a));
+                memcpy(&b, &r[i], sizeof(b));
+                w[i] = a ^ b;
+            }
+        } else {
+            // Clamp the quantised delta to the int32 range; NaN becomes 0
+            for (size_t i = 0; i < dc->n; i++) {
+                float d = (x[i] - r[i]) / dc->quant;
+                if (d != d) d = 0.0f;
+                if (d > 1073741824.0f) d = 1073741824.0f;
+                if (d < -1073741824.0f) d = -1073741824.0f;
+                w[i] = (uint32_t) (int32_t) lrintf(d);
+            }
+        }
+    }
+    delta_apply(dc, keyframe, dc->words, dc->recon, total);
+    *error = 0.0;
+    for (int v = 0; v < dc->nvars; v++)
+        for (size_t i = 0; i < dc->n; i++) {
+            float x = fields[v * dc->stride + i];
+            double diff = fabs((double) x - dc->recon[v * dc->n + i]);
+            if (isfinite(x) && diff > *error) *error = diff;
+        }
+
+    // Compress the byte planes of the words
+    const unsigned char *in = (const unsigned char*) dc->words;
+    for (size_t b = 0; b < sizeof(uint32_t); b++)
+        for (size_t i = 0; i < total; i++)
+            dc->planes[b * total + i] = in[i * sizeof(uint32_t) + b];
+    delta_record_t rec = { keyframe ? 0u : 1u, delta_checksum(dc->recon, total), 0 };
+    size_t bytes = lz_compress(dc->planes, raw, dc->packed);
+    const unsigned char *payload = dc->packed;
+    if (bytes >= raw) {
+        bytes = raw;
+        payload = dc->planes;
+    }
+    rec.bytes = bytes;
+    if (write(dc->fd, &rec, sizeof(rec)) != (ssize_t) sizeof(rec)) {
+        printf("Error writing delta cache step %d\n", dc->step);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    for (size_t done = 0; done < bytes;) {
+        ssize_t put = write(dc->fd, payload + done, bytes - done);
+        if (put <= 0) {
+            printf("Error writing delta cache step %d\n", dc->step);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        done += put;
+    }
+    dc->step++;
+    return sizeof(rec) + bytes;
+}
+
+// Function to read the next step of a delta cache and reconstruct it into
+// fields. times receives the seconds of reading and of decompressing and
+// reconstructing. Returns the bytes read
+size_t delta_read(delta_cache_t *dc, float *fields, double *times) {
+    size_t total = (size_t) dc->nvars * dc->n, raw = total * sizeof(uint32_t);
+    int keyframe = dc->step % dc->keyframe == 0;
+    double t0 = get_time_sec();
+    delta_record_t rec;
+    if (read(dc->fd, &rec, sizeof(rec)) != (ssize_t) sizeof(rec) || rec.kind != (keyframe ? 0u : 1u)
+        || rec.bytes > raw) {
+        printf("Error reading delta cache step %d\n", dc->step);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    unsigned char *payload = rec.bytes < raw ? dc->packed : dc->planes;
+    for (size_t done = 0; done < rec.bytes;) {
+        ssize_t got = read(dc->fd, payload + done, rec.bytes - done);
+        if (got <= 0) {
+            printf("Error reading delta cache step %d\n", dc->step);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        done += got;
+    }
+    double t1 = get_time_sec();
+    if (rec.bytes < raw)
+        lz_decompress(dc->packed, rec.bytes, dc->planes, raw);
+    // Gather the byte planes into words, apply and copy out in blocks that
+    // stay in cache, one pass over the step
+    enum { BLOCK = 4096 };
+    for (int v = 0; v < dc->nvars; v++) {
+        for (size_t i0 = 0; i0 < dc->n; i0 += BLOCK) {
+            size_t m = (dc->n - i0 < BLOCK) ? dc->n - i0 : BLOCK, k0 = v * dc->n + i0;
+            unsigned char *out = (unsigned char*) (dc->words + k0);
+            for (size_t i = 0; i < m; i++)
+                for (size_t b = 0; b < sizeof(uint32_t); b++)
+                    out[i * sizeof(uint32_t) + b] = dc->planes[b * total + k0 + i];
+            delta_apply(dc, keyframe, dc->words + k0, dc->recon + k0, m);
+            memcpy(fields + v * dc->stride + i0, dc->recon + k0, m * sizeof(float));
+        }
+    }
+    times[0] = t1 - t0;
+    times[1] = get_time_sec() - t1;
+    if (delta_checksum(dc->recon, total) != rec.checksum) {
+        printf("Error: delta cache step %d does not match its checksum\n", dc->step);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    dc->step++;
+    return sizeof(rec) + rec.bytes;
+}
+
+// Codecs of the chunk stores. shuffle-lz and lz4 compress the byte planes of
+// a chunk, as written by the shuffle filter of Zarr. shuffle-lz uses the
+// built-in LZ codec under the compressor id "ddread-lz", which other Zarr
+// readers do not know; lz4 writes the numcodecs LZ4 format, the raw size as
+// 4 little-endian bytes followed by one LZ4 block
+#ifdef HAVE_LZ4
+const char *zarr_codec_names[NZARR_CODECS] = { "none", "shuffle-lz", "lz4" };
+#else
+const char *zarr_codec_names[NZARR_CODECS] = { "none", "shuffle-lz", NULL };
+#endif
+
+// Function to get the path of the chunk store in dir of the netCDF file at
+// path: its file name with the extension .nc replaced by .zarr
+void zarr_store_path(const char *dir, const char *path, char *store, size_t size) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    size_t len = strlen(name);
+    if (len > 3 && strcmp(name + len - 3, ".nc") == 0)
+        len -= 3;
+    snprintf(store, size, "%s/%.*s.zarr", dir, (int) len, name);
+}
+
+// Function to get the path of the chunk with grid index idx of variable name
+// in a store, the indices joined by dots ("0" for a scalar)
+static void zarr_chunk_path(const char *store, const char *name, int ndims, const size_t *idx,
+                            char *path, size_t size) {
+    size_t len = (size_t) snprintf(path, size, "%s/%s/%s", store, name, ndims == 0 ? "0" : "");
+    for (int d = 0; d < ndims && len < size; d++)
+        len += (size_t) snprintf(path + len, size - len, d > 0 ? ".%zu" : "%zu", idx[d]);
+}
+
+// Function to get the largest encoded size of a chunk of raw bytes
+static size_t zarr_bound(size_t raw) {
+    size_t bound = lz_bound(raw);
+#ifdef HAVE_LZ4
+    if ((size_t) LZ4_compressBound((int) raw) + 4 > bound)
+        bound = (size_t) LZ4_compressBound((int) raw) + 4;
+#endif
+    return bound;
+}
+
+// Function to encode a chunk of n floats with codec into dst of zarr_bound
+// bytes, with planes of n floats as scratch space. Returns the encoded size
+static size_t zarr_encode(int codec, const float *chunk, size_t n, unsigned char *planes, unsigned char *dst) {
+    size_t raw = n * sizeof(float);
+    if (codec == ZARR_RAW) {
+        memcpy(dst, chunk, raw);
+        return raw;
+    }
+    const unsigned char *in = (const unsigned char*) chunk;
+    for (size_t b = 0; b < sizeof(float); b++)
+        for (size_t i = 0; i < n; i++)
+            planes[b * n + i] = in[i * sizeof(float) + b];
+#ifdef HAVE_LZ4
+    if (codec == ZARR_LZ4) {
+        for (int k = 0; k < 4; k++)
+            dst[k] = (unsigned char) (raw >> (8 * k));
+        return 4 + (size_t) LZ4_compress_default((const char*) planes, (char*) dst + 4, (int) raw,
+                                                 LZ4_compressBound((int) raw));
+    }
+#endif
+    return lz_compress(planes, raw, dst);
+}
+
+// Function to decode a chunk of n floats from bytes of src encoded with codec
+// into chunk, with planes of n floats as scratch space. Uncompressed chunks
+// are read straight into chunk and only checked. Returns 0 if the data does
+// not decode to n floats
+static int zarr_decode(int codec, const unsigned char *src, size_t bytes, unsigned char *planes,
+                       float *chunk, size_t n) {
+    size_t raw = n * sizeof(float);
+    if (codec == ZARR_RAW)
+        return bytes == raw;
+#ifdef HAVE_LZ4
+    if (codec == ZARR_LZ4) {
+        size_t size = bytes < 4 ? 0 : src[0] | ((size_t) src[1] << 8) | ((size_t) src[2] << 16)
+                                      | ((size_t) src[3] << 24);
+        if (size != raw || LZ4_decompress_safe((const char*) src + 4, (char*) planes, (int) (bytes - 4),
+                                               (int) raw) != (int) raw)
+            return 0;
+    } else
+#endif
+    if (lz_decompress(src, bytes, planes, raw) != raw)
+        return 0;
+    // Gather the byte planes back into floats
+    unsigned char *out = (unsigned char*) chunk;
+    for (size_t i = 0; i < n; i++)
+        for (size_t b = 0; b < sizeof(float); b++)
+            out[i * sizeof(float) + b] = planes[b * n + i];
+    return 1;
+}
+
+// Function to write n bytes of data to a new file at path. Returns 0 on success
+static int write_file(const char *path, const void *data, size_t n) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    for (size_t done = 0; done < n;) {
+        ssize_t put = write(fd, (const char*) data + done, n - done);
+        if (put <= 0) {
+            close(fd);
+            return -1;
+        }
+        done += put;
+    }
+    return close(fd);
+}
+
+// Function to read the whole file at path into data of cap bytes. Returns
+// the size of the file, or -1 with errno set if it cannot be read or does
+// not fit
+static ssize_t read_file(const char *path, void *data, size_t cap) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size > cap) {
+        close(fd);
+        errno = EFBIG;
+        return -1;
+    }
+    size_t done = 0;
+    while (done < (size_t) st.st_size) {
+        ssize_t got = read(fd, (char*) data + done, st.st_size - done);
+        if (got <= 0) {
+            close(fd);
+            errno = EIO;
+            return -1;
+        }
+        done += got;
+    }
+    close(fd);
+    return (ssize_t) done;
+}
+
+// Function to write the JSON metadata of one array of a chunk store into
+// the directory dir: .zarray with shape, chunks, fill value and codec, and
+// .zattrs with the names of its dimensions. Returns 0 on success
+static int zarr_write_meta(const char *dir, int ndims, const zarr_array_t *a, char (*dims)[NC_MAX_NAME + 1]) {
+    static const char *filters[NZARR_CODECS] = { "null", "[{\"id\": \"shuffle\", \"elementsize\": 4}]",
+                                                 "[{\"id\": \"shuffle\", \"elementsize\": 4}]" };
+    static const char *compressors[NZARR_CODECS] = { "null", "{\"id\": \"ddread-lz\"}",
+                                                     "{\"id\": \"lz4\", \"acceleration\": 1}" };
+    char path[4096 + 16];  // dir of at most 4096 bytes and the file name
+    snprintf(path, sizeof(path), "%s/.zarray", dir);
+    FILE *fp = fopen(path, "w");
+    if (fp == NULL)
+        return -1;
+    fprintf(fp, "{\n    \"zarr_format\": 2,\n    \"shape\": [");
+    for (int d = 0; d < ndims; d++)
+        fprintf(fp, "%s%zu", d > 0 ? ", " : "", a->shape[d]);
+    fprintf(fp, "],\n    \"chunks\": [");
+    for (int d = 0; d < ndims; d++)
+        fprintf(fp, "%s%zu", d > 0 ? ", " : "", a->chunks[d]);
+    fprintf(fp, "],\n    \"dtype\": \"<f4\",\n    \"order\": \"C\",\n");
+    if (isnan(a->fill))
+        fprintf(fp, "    \"fill_value\": \"NaN\",\n");
+    else
+        fprintf(fp, "    \"fill_value\": %.9g,\n", a->fill);
+    fprintf(fp, "    \"filters\": %s,\n    \"compressor\": %s,\n    \"dimension_separator\": \".\"\n}\n",
+            filters[a->codec], compressors[a->codec]);
+    if (fclose(fp) != 0)
+        return -1;
+    snprintf(path, sizeof(path), "%s/.zattrs", dir);
+    fp = fopen(path, "w");
+    if (fp == NULL)
+        return -1;
+    fprintf(fp, "{\n    \"_ARRAY_DIMENSIONS\": [");
+    for (int d = 0; d < ndims; d++)
+        fprintf(fp, "%s\"%s\"", d > 0 ? ", " : "", dims[d]);
+    fprintf(fp, "]\n}\n");
+    return fclose(fp);
+}
+
+// Function to read the fill value of a numeric variable in its own type and
+// convert it to float, as nc_get_vara_float converts the data. Returns
+// NC_FILL_FLOAT for types without a conversion
+static float var_fill(int ncid, int varid, nc_type xtype) {
+    union {
+        signed char b;
+        unsigned char ub;
+        short s;
+        unsigned short us;
+        int i;
+        unsigned int ui;
+        long long i64;
+        unsigned long long u64;
+        float f;
+        double d;
+    } v;
+    int no_fill;
+    if (nc_inq_var_fill(ncid, varid, &no_fill, &v) != NC_NOERR)
+        return NC_FILL_FLOAT;
+    switch (xtype) {
+        case NC_BYTE: return (float) v.b;
+        case NC_UBYTE: return (float) v.ub;
+        case NC_SHORT: return (float) v.s;
+        case NC_USHORT: return (float) v.us;
+        case NC_INT: return (float) v.i;
+        case NC_UINT: return (float) v.ui;
+        case NC_INT64: return (float) v.i64;
+        case NC_UINT64: return (float) v.u64;
+        case NC_FLOAT: return v.f;
+        case NC_DOUBLE: return (float) v.d;
+        default: return NC_FILL_FLOAT;
+    }
+}
+
+// Function to create a directory that may already exist, aborting on failure
+static void make_dir(const char *path) {
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        printf("Error creating directory %s\n", path);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Function to convert the netCDF file at path into the chunk store store on
+// all ranks of comm. Each variable keeps its netCDF chunks; contiguous
+// variables get lat/lon chunks of 64 with all other dimensions whole, and a
+// non-zero edge sets the lat/lon chunk edge of all variables. Rank 0 writes
+// the metadata, then the chunks of all variables are dealt to the ranks
+// round-robin, each read with nc_get_vara_float from a serial open, padded
+// with the fill value of the variable, converted to float, at the upper
+// boundaries and encoded with codec. Text variables are left out. bytes receives the raw and the stored bytes of the
+// chunks of this rank. Returns seconds
+double zarr_convert(const bench_t *b, const char *path, const char *store, int codec, size_t edge,
+                    MPI_Comm comm, size_t *bytes) {
+    double t0 = get_time_sec();
+    int rank, nprocs;
+    MPI_Comm_rank(comm, &rank);
+    MPI_Comm_size(comm, &nprocs);
+    int ncid = open_serial(b, path, 0);
+    int nvars = b->nvars + b->dimvars;
+    zarr_array_t *arrays = (zarr_array_t*) calloc(nvars, sizeof(zarr_array_t));
+    int *ndims = (int*) calloc(nvars, sizeof(int));
+    size_t max_chunk = 1;
+    for (int varid = 0; varid < nvars; varid++) {
+        zarr_array_t *a = &arrays[varid];
+        int dimids[MAX_DIMS], storage;
+        nc_type xtype;
+        int retval = nc_inq_varndims(ncid, varid, &ndims[varid]);
+        if (retval == NC_NOERR && ndims[varid] > MAX_DIMS)
+            retval = NC_EINVAL;
+        if (retval == NC_NOERR)
+            retval = nc_inq_var(ncid, varid, NULL, &xtype, NULL, dimids, NULL);
+        if (retval == NC_NOERR)
+            retval = nc_inq_var_chunking(ncid, varid, &storage, a->chunks);
+        if (retval != NC_NOERR) {
+            printf("Rank %d: Error querying variable %s of %s: %s\n", rank, b->varnames[varid], path,
+                   nc_strerror(retval));
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        if (xtype == NC_CHAR || xtype == NC_STRING) {
+            ndims[varid] = -1;
+            continue;
+        }
+        a->codec = codec;
+        a->fill = var_fill(ncid, varid, xtype);
+        size_t n = 1;
+        for (int d = 0; d < ndims[varid]; d++) {
+            int plane = dimids[d] == b->lat_idx || dimids[d] == b->lon_idx;
+            a->shape[d] = b->dimlen[dimids[d]];
+            if (storage != NC_CHUNKED)
+                a->chunks[d] = plane ? 64 : a->shape[d];
+            if (plane && edge > 0)
+                a->chunks[d] = edge;
+            if (a->chunks[d] > a->shape[d])
+                a->chunks[d] = a->shape[d];
+            if (a->chunks[d] == 0)
+                a->chunks[d] = 1;
+            n *= a->chunks[d];
+        }
+        if (n > max_chunk)
+            max_chunk = n;
+    }
+
+    // Directories and metadata
+    char dir[4096];
+    if (rank == 0) {
+        make_dir(store);
+        snprintf(dir, sizeof(dir), "%s/.zgroup", store);
+        if (write_file(dir, "{\n    \"zarr_format\": 2\n}\n", 25) != 0) {
+            printf("Error writing %s\n", dir);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        for (int varid = 0; varid < nvars; varid++) {
+            if (ndims[varid] < 0) continue;
+            int dimids[MAX_DIMS];
+            char dims[MAX_DIMS][NC_MAX_NAME + 1];
+            nc_inq_vardimid(ncid, varid, dimids);
+            for (int d = 0; d < ndims[varid]; d++)
+                nc_inq_dim(ncid, dimids[d], dims[d], NULL);
+            snprintf(dir, sizeof(dir), "%s/%s", store, b->varnames[varid]);
+            make_dir(dir);
+            if (zarr_write_meta(dir, ndims[varid], &arrays[varid], dims) != 0) {
+                printf("Error writing the metadata of %s\n", dir);
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+        }
+    }
+    MPI_Barrier(comm);
+
+    // Chunks, round-robin over all variables
+    float *chunk = (float*) malloc(max_chunk * sizeof(float));
+    float *part = (float*) malloc(max_chunk * sizeof(float));
+    unsigned char *planes = (unsigned char*) malloc(max_chunk * sizeof(float));
+    unsigned char *packed = (unsigned char*) malloc(zarr_bound(max_chunk * sizeof(float)));
+    bytes[0] = bytes[1] = 0;
+    size_t next = 0;
+    for (int varid = 0; varid < nvars; varid++) {
+        if (ndims[varid] < 0) continue;
+        const zarr_array_t *a = &arrays[varid];
+        int nd = ndims[varid];
+        size_t grid[MAX_DIMS], nchunks = 1, n = 1;
+        for (int d = 0; d < nd; d++) {
+            grid[d] = (a->shape[d] + a->chunks[d] - 1) / a->chunks[d];
+            nchunks *= grid[d];
+            n *= a->chunks[d];
+        }
+        for (size_t c = 0; c < nchunks; c++, next++) {
+            if (next % nprocs != (size_t) rank) continue;
+            size_t idx[MAX_DIMS];
+            box_t box, clip;
+            int whole = 1;
+            size_t rest = c;
+            for (int d = nd - 1; d >= 0; d--) {
+                idx[d] = rest % grid[d];
+                rest /= grid[d];
+                box.start[d] = clip.start[d] = idx[d] * a->chunks[d];
+                box.count[d] = a->chunks[d];
+                clip.count[d] = a->shape[d] - box.start[d] < a->chunks[d] ? a->shape[d] - box.start[d] : a->chunks[d];
+                whole &= clip.count[d] == box.count[d];
+            }
+            int retval = nc_get_vara_float(ncid, varid, clip.start, clip.count, whole ? chunk : part);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error reading a chunk of %s from %s: %s\n", rank, b->varnames[varid], path,
+                       nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            if (!whole) {
+                for (size_t i = 0; i < n; i++)
+                    chunk[i] = a->fill;
+                box_copy(nd, &clip, &clip, part, &box, chunk);
+            }
+            bytes[0] += box_size(nd, &clip) * sizeof(float);
+            // Chunks of fill values only are left to the reader
+            size_t i = 0;
+            while (i < n && memcmp(&chunk[i], &a->fill, sizeof(float)) == 0)
+                i++;
+            if (i == n) continue;
+            size_t size = zarr_encode(a->codec, chunk, n, planes, packed);
+            zarr_chunk_path(store, b->varnames[varid], nd, idx, dir, sizeof(dir));
+            if (write_file(dir, packed, size) != 0) {
+                printf("Rank %d: Error writing chunk %s\n", rank, dir);
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            bytes[1] += size;
+        }
+    }
+    nc_close(ncid);
+    free(chunk);
+    free(part);
+    free(planes);
+    free(packed);
+    free(arrays);
+    free(ndims);
+    MPI_Barrier(comm);
+    return get_time_sec() - t0;
+}
+
+// Function to discover the dimensions and variables of the open file ncid and
+// the indices of the lon/lat dimensions, which need coordinate variables.
+// Fills the metadata fields of b; rank and nprocs must already be set
+void ddr_scan(int ncid, const char *lon_name, const char *lat_name, bench_t *b) {
+    int nvars, ndims;
+    int retval = nc_inq(ncid, &ndims, &nvars, NULL, NULL);
+    if (retval != NC_NOERR) {
+        printf("Error querying number of dimensions & variables: %s\n", nc_strerror(retval));
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    b->ndims = ndims;
+    b->dimvars = 0;
+    b->lat_idx = -1;
+    b->lon_idx = -1;
+    b->dimlen = (size_t*) malloc(ndims * sizeof(size_t));
+    b->dimnames = malloc(ndims * sizeof(*b->dimnames));
+    b->is_dimvar = (int*) calloc(nvars, sizeof(int));
+    b->varnames = malloc(nvars * sizeof(*b->varnames));
+    b->var_ndims = (int*) malloc(nvars * sizeof(int));
+    b->var_dimids = malloc(nvars * sizeof(*b->var_dimids));
+    b->nsplit = 0;
+    b->is_split = NULL;
+    b->var_nboxes = NULL;
+    b->var_boxes = NULL;
+    for (int varid = 0; varid < nvars; varid++) {
+        retval = nc_inq_varname(ncid, varid, b->varnames[varid]);
+        if (retval != NC_NOERR) {
+            printf("Error querying variable name for varid %d: %s\n", varid, nc_strerror(retval));
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        int vdims[NC_MAX_VAR_DIMS];
+        if (nc_inq_varndims(ncid, varid, &b->var_ndims[varid]) != NC_NOERR || b->var_ndims[varid] > MAX_DIMS
+            || nc_inq_vardimid(ncid, varid, vdims) != NC_NOERR) {
+            printf("Error querying dimensions of var %s (at most %d supported)\n", b->varnames[varid], MAX_DIMS);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        memcpy(b->var_dimids[varid], vdims, b->var_ndims[varid] * sizeof(int));
+    }
+    for (int dimid = 0; dimid < ndims; dimid++) {
+        char *dim_name = b->dimnames[dimid];
+        retval = nc_inq_dim(ncid, dimid, dim_name, &b->dimlen[dimid]);
+        if (retval != NC_NOERR) {
+            printf("Error querying dimension ID %d: %s\n", dimid, nc_strerror(retval));
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        for (int varid = 0; varid < nvars; varid++) {
+            if (strcmp(b->varnames[varid], dim_name) == 0) {
+                b->dimvars++;
+                b->is_dimvar[varid] = 1;
+                if (strcmp(lon_name, dim_name) == 0) {
+                    b->lon_idx = dimid;
+                    if (b->rank == 0)
+                        printf("Found lon dimension at index %d\n", b->lon_idx);
+                } else if (strcmp(lat_name, dim_name) == 0) {
+                    b->lat_idx = dimid;
+                    if (b->rank == 0)
+                        printf("Found lat dimension at index %d\n", b->lat_idx);
+                }
+                break;
+            }
+        }
+        if (b->rank == 0)
+            printf("  Dimension %d: name='%s', length=%zu\n", dimid, dim_name, b->dimlen[dimid]);
+    }
+    if (b->lat_idx == -1 || b->lon_idx == -1) {
+        printf("Error: Could not find %s/%s dimensions\n", lat_name, lon_name);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    b->nvars = nvars - b->dimvars;
+}
+
+// Function to set the boxes of every data variable from the segments of the
+// dimensions of the file (nseg[dimid] of at most three, the decomposed ones
+// marked in b->is_split): the product of the segments of the dimensions the
+// variable has, the last dimension varying fastest. Returns the size in floats
+// of the largest variable
+static size_t set_var_boxes(bench_t *b, const int *nseg, size_t (*seg_start)[3], size_t (*seg_count)[3]) {
+    int nvars = b->nvars + b->dimvars;
+    if (b->var_boxes == NULL) {
+        b->var_nboxes = (int*) calloc(nvars, sizeof(int));
+        b->var_boxes = (box_t**) calloc(nvars, sizeof(box_t*));
+    }
+    size_t maxsize = 0;
+    for (int varid = 0; varid < nvars; varid++) {
+        if (b->is_dimvar[varid]) continue;
+        int vndims = b->var_ndims[varid];
+        const int *dimids = b->var_dimids[varid];
+        int nboxes = 1;
+        for (int d = 0; d < vndims; d++)
+            nboxes *= nseg[dimids[d]];
+        free(b->var_boxes[varid]);
+        b->var_boxes[varid] = (box_t*) calloc(nboxes, sizeof(box_t));
+        b->var_nboxes[varid] = nboxes;
+        size_t size = 0;
+        for (int p = 0; p < nboxes; p++) {
+            box_t *box = &b->var_boxes[varid][p];
+            for (int d = vndims - 1, q = p; d >= 0; d--) {
+                int g = dimids[d];
+                box->start[d] = seg_start[g][q % nseg[g]];
+                box->count[d] = seg_count[g][q % nseg[g]];
+                q /= nseg[g];
+            }
+            size += box_size(vndims, box);
+        }
+        if (size > maxsize) maxsize = size;
+    }
+    return maxsize;
+}
+
+// Function to set the segments of the dimensions of the file to their full
+// extent, none decomposed
+static void full_segments(bench_t *b, int *nseg, size_t (*seg_start)[3], size_t (*seg_count)[3]) {
+    if (b->is_split == NULL)
+        b->is_split = (int*) malloc(b->ndims * sizeof(int));
+    for (int g = 0; g < b->ndims; g++) {
+        b->is_split[g] = 0;
+        nseg[g] = 1;
+        seg_start[g][0] = 0;
+        seg_count[g][0] = b->dimlen[g];
+    }
+}
+
+// Function to decompose the lat/lon plane over a nproc_x x nproc_y grid.
+// Sets the grid, the pieces of the rank (of its ensemble member or job), the
+// boxes of each data variable and the buffer size in floats of the largest
+// variable, the same on all ranks. Variables without lat or lon are not split
+// along the missing dimension
+void ddr_decompose(bench_t *b, int nproc_x, int nproc_y, int halo) {
+    int px = b->rank % nproc_x;
+    int py = (b->rank / nproc_x) % nproc_y;
+    int lon_size = b->dimlen[b->lon_idx], lat_size = b->dimlen[b->lat_idx];
+    b->nproc_x = nproc_x;
+    b->nproc_y = nproc_y;
+    b->halo = halo;
+    b->nsplit = 0;
+    compute_pieces(px, py, nproc_x, nproc_y, halo, lon_size, lat_size, b->pieces);
+    // Wrap pieces are only read if some rank has a halo (halo is the same on all ranks)
+    b->npieces = (halo > 0) ? NPIECES : 1;
+
+    int *nseg = (int*) malloc(b->ndims * sizeof(int));
+    size_t (*seg_start)[3] = malloc(b->ndims * sizeof(*seg_start));
+    size_t (*seg_count)[3] = malloc(b->ndims * sizeof(*seg_count));
+    full_segments(b, nseg, seg_start, seg_count);
+    b->is_split[b->lat_idx] = b->is_split[b->lon_idx] = 1;
+    seg_start[b->lat_idx][0] = b->pieces[PIECE_INTERIOR].lat0;
+    seg_count[b->lat_idx][0] = b->pieces[PIECE_INTERIOR].nlat;
+    nseg[b->lon_idx] = b->npieces;
+    for (int p = 0; p < b->npieces; p++) {
+        seg_start[b->lon_idx][p] = b->pieces[p].lon0;
+        seg_count[b->lon_idx][p] = b->pieces[p].nlon;
+    }
+    set_var_boxes(b, nseg, seg_start, seg_count);
+    free(nseg);
+    free(seg_start);
+    free(seg_count);
+
+    // The largest subdomain of any rank
+    b->bufsize = 0;
+    for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+        if (b->is_dimvar[varid]) continue;
+        size_t size = 1;
+        for (int d = 0; d < b->var_ndims[varid]; d++) {
+            int g = b->var_dimids[varid][d];
+            size *= (g == b->lat_idx) ? (size_t) (lat_size / nproc_y + 2 * halo)
+                  : (g == b->lon_idx) ? (size_t) (lon_size / nproc_x + 2 * halo) : b->dimlen[g];
+        }
+        if (size > b->bufsize) b->bufsize = size;
+    }
+}
+
+// Function to decompose any set of named dimensions, each with its own number
+// of ranks, halo width and periodicity; the first dimension of split varies
+// fastest with the rank. Every data variable gets the product of the segments
+// of the decomposed dimensions it has and the full extent of all others, so
+// 2D fields next to 3D fields read only their own subdomain. The buffer size
+// is that of the largest variable of this rank. There are no lat/lon pieces
+void ddr_decompose_nd(bench_t *b, const split_dim_t *split, int nsplit) {
+    int *nseg = (int*) malloc(b->ndims * sizeof(int));
+    size_t (*seg_start)[3] = malloc(b->ndims * sizeof(*seg_start));
+    size_t (*seg_count)[3] = malloc(b->ndims * sizeof(*seg_count));
+    full_segments(b, nseg, seg_start, seg_count);
+    int nprocs = 1;
+    for (int i = 0, r = b->rank; i < nsplit; i++) {
+        int g = 0;
+        while (g < b->ndims && strcmp(b->dimnames[g], split[i].name) != 0)
+            g++;
+        if (g == b->ndims || b->is_split[g]) {
+            if (b->rank == 0)
+                printf("Error: decomposed dimension %s not found or given twice\n", split[i].name);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        b->is_split[g] = 1;
+        nseg[g] = split_segments(b->dimlen[g], r % split[i].nproc, &split[i], seg_start[g], seg_count[g]);
+        r /= split[i].nproc;
+        nprocs *= split[i].nproc;
+    }
+    if (nprocs != b->nprocs) {
+        if (b->rank == 0)
+            printf("Error: the decomposition needs %d ranks, not %d\n", nprocs, b->nprocs);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    b->nproc_x = b->nproc_y = 1;
+    b->halo = 0;
+    b->nsplit = nsplit;
+    memset(b->pieces, 0, sizeof(b->pieces));
+    b->npieces = 0;
+    b->bufsize = set_var_boxes(b, nseg, seg_start, seg_count);
+    if (b->bufsize == 0)
+        b->bufsize = 1;
+    free(nseg);
+    free(seg_start);
+    free(seg_count);
+}
+
+// Function to check that the setup is a lat/lon decomposition of data
+// variables that all span every dimension of the file in file order, as the
+// engines and modes built on the lat/lon pieces expect. Returns 1 if so
+int ddr_full_vars(const bench_t *b) {
+    if (b->nsplit > 0)
+        return 0;
+    for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+        if (b->is_dimvar[varid]) continue;
+        if (b->var_ndims[varid] != b->ndims)
+            return 0;
+        for (int d = 0; d < b->ndims; d++)
+            if (b->var_dimids[varid][d] != d)
+                return 0;
+    }
+    return 1;
+}
+
+// Function to free the metadata allocated by ddr_scan and the decomposition
+void ddr_free(bench_t *b) {
+    if (b->var_boxes != NULL)
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++)
+            free(b->var_boxes[varid]);
+    free(b->var_boxes);
+    free(b->var_nboxes);
+    free(b->is_split);
+    free(b->var_ndims);
+    free(b->var_dimids);
+    free(b->dimlen);
+    free(b->dimnames);
+    free(b->is_dimvar);
+    free(b->varnames);
+}
+
+// Open file and engine state of a reader, private to the library
+struct ddr_state {
+    int is_setup;               // Engine setup done by the first ddr_open
+    int ncid;                   // Open netCDF file, -1 if none
+    float *scratch;             // File-order pieces before the transpose
+    size_t scratch_size;
+    two_phase_t *tp;            // Aggregator setup of the twophase engine
+    char *zarr_store;           // Open chunk store of the zarr engine, NULL if none
+    zarr_array_t *zarr;         // Its data variables, by varid
+    hid_t h5_file, h5_dxpl;     // Open file of the hdf5 engine, -1 if none
+    hid_t *h5_dsets;            // Its data variables, by varid
+    MPI_Comm bcast_comm;        // Ranks sharing each read of the bcast engine
+    int bcast_files;            // Files opened so far, picks the reading rank
+    char *bcast_mem;            // File contents, in bcast_win if shared
+    size_t bcast_capacity;
+    MPI_Win bcast_win;
+};
+
+// Function to stop with an error if an engine is given a target layout it
+// cannot store its pieces in
+static void reject_layout(const ddr_reader_t *r) {
+    if (r->opt.layout != NULL) {
+        printf("Error: the %s engine reads in file order only\n", r->engine->name);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Function to stop with an error if an engine built on the lat/lon pieces of
+// full-dimensional variables is given another setup (see ddr_full_vars)
+static void require_full_vars(const ddr_reader_t *r, const char *what) {
+    if (!ddr_full_vars(r->b)) {
+        printf("Error: %s needs a lat/lon decomposition of variables over all dimensions\n", what);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Function to set the hyperslab of box p of a variable in its own index
+// space: the box of the decomposition along the decomposed dimensions and the
+// hyperslab of the reader along all others. Returns its size in floats
+static size_t var_hyperslab(const ddr_reader_t *r, int varid, int p, size_t *start, size_t *count) {
+    const bench_t *b = r->b;
+    const box_t *box = &b->var_boxes[varid][p];
+    size_t n = 1;
+    for (int d = 0; d < b->var_ndims[varid]; d++) {
+        int g = b->var_dimids[varid][d];
+        start[d] = b->is_split[g] ? box->start[d] : r->start[g];
+        count[d] = b->is_split[g] ? box->count[d] : r->count[g];
+        n *= count[d];
+    }
+    return n;
+}
+
+// Function to read the boxes of one variable back to back in file order.
+// Collective reads issue every box, with zero counts where absent
+static int read_boxes(ddr_reader_t *r, int varid, int use_independent, float *buffer) {
+    float *dst = buffer;
+    for (int p = 0; p < r->b->var_nboxes[varid]; p++) {
+        size_t start[MAX_DIMS], count[MAX_DIMS];
+        size_t n = var_hyperslab(r, varid, p, start, count);
+        if (n == 0 && use_independent) continue;
+        int retval = nc_get_vara_float(r->state->ncid, varid, start, count, dst);
+        if (retval != NC_NOERR)
+            return retval;
+        dst += n;
+    }
+    return NC_NOERR;
+}
+
+// Engine callbacks: parallel netCDF with the access mode of the setup. The
+// file order follows any decomposition; a target layout needs the lat/lon
+// pieces
+static void layout_setup(ddr_reader_t *r) {
+    if (r->opt.layout != NULL)
+        require_full_vars(r, "a target layout");
+}
+
+static void direct_open(ddr_reader_t *r, const char *path) {
+    r->state->ncid = open_par(r->b, path, r->comm, r->b->use_independent);
+}
+
+// Function to read the pieces of one variable in the target layout of the
+// reader: in file order, mapped by netCDF, or read in file order into scratch
+// space and transposed piece by piece
+static int read_layout(ddr_reader_t *r, int varid, int use_independent, float *buffer) {
+    const bench_t *b = r->b;
+    struct ddr_state *s = r->state;
+    if (r->opt.layout == NULL)
+        return read_boxes(r, varid, use_independent, buffer);
+    if (r->opt.mapped)
+        return read_pieces_mapped(s->ncid, varid, b->ndims, b->lat_idx, b->lon_idx, b->pieces, b->npieces,
+                                  use_independent, r->opt.layout, r->start, r->count, buffer);
+    size_t counts[NPIECES][MAX_DIMS], sizes[NPIECES];
+    size_t n = piece_counts(b, r->count, counts, sizes);
+    if (n > s->scratch_size) {
+        free(s->scratch);
+        s->scratch = (float*) malloc(n * sizeof(float));
+        s->scratch_size = n;
+    }
+    int retval = read_pieces(s->ncid, varid, b->ndims, b->lat_idx, b->lon_idx, b->pieces, b->npieces,
+                             use_independent, r->start, r->count, s->scratch);
+    if (retval != NC_NOERR)
+        return retval;
+    double t0 = get_time_sec();
+    size_t off = 0;
+    for (int p = 0; p < b->npieces; p++) {
+        permute_box(b->ndims, counts[p], r->opt.layout, s->scratch + off, buffer + off);
+        off += sizes[p];
+    }
+    r->stats.transpose_time += get_time_sec() - t0;
+    return NC_NOERR;
+}
+
+static int direct_read(ddr_reader_t *r, int varid, float *buffer) {
+    return read_layout(r, varid, r->b->use_independent, buffer);
+}
+
+static void close_ncid(ddr_reader_t *r) {
+    nc_close(r->state->ncid);
+    r->state->ncid = -1;
+}
+
+// Serial nc__open on every rank with the readahead hint of the options
+static void serial_open(ddr_reader_t *r, const char *path) {
+    r->state->ncid = open_serial(r->b, path, r->opt.readahead);
+}
+
+static int serial_read(ddr_reader_t *r, int varid, float *buffer) {
+    return read_layout(r, varid, 1, buffer);
+}
+
+// Two-phase I/O over the communicator of the reader, one rank per subdomain;
+// only the aggregators access the file, independently
+static void two_phase_setup(ddr_reader_t *r) {
+    reject_layout(r);
+    require_full_vars(r, "the twophase engine");
+    r->state->tp = (two_phase_t*) malloc(sizeof(two_phase_t));
+    two_phase_init(r->state->tp, r->b, r->comm, r->opt.naggr, r->opt.aggr_placement, r->opt.cb_buffer,
+                   r->opt.stripe_size);
+    const two_phase_t *tp = r->state->tp;
+    if (r->opt.verbose && tp->rank == 0) {
+        printf("Two-phase aggregators: %d (placement=%s, cb_buffer=%zu bytes, stripe_size=%zu bytes), ranks=",
+               tp->naggr, r->opt.aggr_placement, tp->cb_buffer, tp->align);
+        for (int a = 0; a < tp->naggr; a++)
+            printf("%d%s", tp->aggr_ranks[a], a < tp->naggr - 1 ? "," : "\n");
+    }
+}
+
+static void two_phase_open(ddr_reader_t *r, const char *path) {
+    two_phase_t *tp = r->state->tp;
+    if (tp->align > 0)
+        two_phase_offsets(tp, path, r->b->nvars + r->b->dimvars, r->b->varnames, r->comm);
+    r->state->ncid = open_par(r->b, path, r->comm, 1);
+}
+
+static int two_phase_read(ddr_reader_t *r, int varid, float *buffer) {
+    return read_var_two_phase(r->state->tp, r->state->ncid, varid, r->b->dimlen, buffer);
+}
+
+// HDF5 API on the netCDF-4 file through the MPI-IO driver, with the access
+// mode of the setup and collective metadata reads if coll_metadata is set.
+// All data variables are opened as datasets of the same name with the file
+// and read over all non-decomposed dimensions in file order; with sparse,
+// unallocated chunks are skipped (read_pieces_sparse)
+static void hdf5_setup(ddr_reader_t *r) {
+    reject_layout(r);
+    require_full_vars(r, "the hdf5 engine");
+}
+
+static void hdf5_open(ddr_reader_t *r, const char *path) {
+    const bench_t *b = r->b;
+    struct ddr_state *s = r->state;
+    hid_t fapl = H5Pcreate(H5P_FILE_ACCESS);
+    s->h5_dxpl = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_fapl_mpio(fapl, r->comm, MPI_INFO_NULL);
+    H5Pset_all_coll_metadata_ops(fapl, r->opt.coll_metadata ? 1 : 0);
+    H5Pset_dxpl_mpio(s->h5_dxpl, b->use_independent ? H5FD_MPIO_INDEPENDENT : H5FD_MPIO_COLLECTIVE);
+#endif
+    s->h5_file = H5Fopen(path, H5F_ACC_RDONLY, fapl);
+    H5Pclose(fapl);
+    if (s->h5_file < 0) {
+        printf("Rank %d: Error opening file %s with HDF5\n", b->rank, path);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    s->h5_dsets = (hid_t*) malloc((b->nvars + b->dimvars) * sizeof(hid_t));
+    for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+        s->h5_dsets[varid] = -1;
+        if (b->is_dimvar[varid]) continue;
+        s->h5_dsets[varid] = H5Dopen2(s->h5_file, b->varnames[varid], H5P_DEFAULT);
+        if (s->h5_dsets[varid] < 0) {
+            printf("Rank %d: Error opening dataset %s in file %s\n", b->rank, b->varnames[varid], path);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+    }
+}
+
+static int hdf5_read(ddr_reader_t *r, int varid, float *buffer) {
+    struct ddr_state *s = r->state;
+    size_t skipped = 0;
+    herr_t status = r->opt.sparse ? read_pieces_sparse(r->b, s->h5_dsets[varid], s->h5_dxpl, buffer, &skipped)
+                                  : read_pieces_hdf5(r->b, s->h5_dsets[varid], s->h5_dxpl, buffer);
+    r->stats.skipped += skipped;
+    return (status < 0) ? NC_EHDFERR : NC_NOERR;
+}
+
+static void hdf5_close(ddr_reader_t *r) {
+    struct ddr_state *s = r->state;
+    for (int varid = 0; varid < r->b->nvars + r->b->dimvars; varid++)
+        if (s->h5_dsets[varid] >= 0) H5Dclose(s->h5_dsets[varid]);
+    free(s->h5_dsets);
+    s->h5_dsets = NULL;
+    H5Pclose(s->h5_dxpl);
+    H5Fclose(s->h5_file);
+    s->h5_file = -1;
+}
+
+// Read once and broadcast. One rank of bcast_comm (round-robin over the files
+// opened) reads the whole file with large sequential reads and distributes
+// the raw bytes by MPI_Bcast, or with bcast_shm through a shared memory
+// window, for which bcast_comm must be node-local. Every rank then opens the
+// bytes with nc_open_mem and extracts its subdomain from memory
+static void bcast_setup(ddr_reader_t *r) {
+    struct ddr_state *s = r->state;
+    layout_setup(r);
+    s->bcast_comm = (r->opt.bcast_comm != MPI_COMM_NULL) ? r->opt.bcast_comm : r->comm;
+    int crank, csize;
+    MPI_Comm_rank(s->bcast_comm, &crank);
+    MPI_Comm_size(s->bcast_comm, &csize);
+    if (r->opt.read_size == 0) {
+        if (crank == 0)
+            printf("Error: the bcast engine needs a positive read_size\n");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+
+    // A shared window needs all ranks of the communicator on one node
+    if (r->opt.bcast_shm) {
+        MPI_Comm node_comm;
+        int node_size;
+        MPI_Comm_split_type(s->bcast_comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &node_comm);
+        MPI_Comm_size(node_comm, &node_size);
+        MPI_Comm_free(&node_comm);
+        int local = (node_size == csize), all_local;
+        MPI_Allreduce(&local, &all_local, 1, MPI_INT, MPI_LAND, s->bcast_comm);
+        if (!all_local) {
+            if (crank == 0)
+                printf("Error: the shared memory bcast engine needs a node-local communicator\n");
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+    }
+}
+
+static void bcast_open(ddr_reader_t *r, const char *path) {
+    const bench_t *b = r->b;
+    struct ddr_state *s = r->state;
+    MPI_Comm comm = s->bcast_comm;
+    int crank, csize;
+    MPI_Comm_rank(comm, &crank);
+    MPI_Comm_size(comm, &csize);
+    int reader = s->bcast_files++ % csize;
+
+    // The reader determines the file size and shares it
+    unsigned long long size = 0;
+    if (crank == reader) {
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            printf("Rank %d: Error querying size of file %s\n", b->rank, path);
+            safe_abort(MPI_COMM_WORLD, 1);
+        }
+        size = st.st_size;
+    }
+    MPI_Bcast(&size, 1, MPI_UNSIGNED_LONG_LONG, reader, comm);
+
+    // Make room for the file, in a shared window or in private memory
+    if (size > s->bcast_capacity) {
+        if (r->opt.bcast_shm) {
+            if (s->bcast_win != MPI_WIN_NULL) {
+                MPI_Win_unlock_all(s->bcast_win);
+                MPI_Win_free(&s->bcast_win);
+            }
+            MPI_Aint winsize = (crank == 0) ? (MPI_Aint) size : 0;
+            MPI_Win_allocate_shared(winsize, 1, MPI_INFO_NULL, comm, &s->bcast_mem, &s->bcast_win);
+            MPI_Aint qsize;
+            int disp;
+            MPI_Win_shared_query(s->bcast_win, 0, &qsize, &disp, &s->bcast_mem);
+            // Loads and stores go to the window in a passive target
+            // epoch, ordered by MPI_Win_sync around each barrier
+            MPI_Win_lock_all(MPI_MODE_NOCHECK, s->bcast_win);
+        } else {
+            free(s->bcast_mem);
+            s->bcast_mem = (char*) malloc(size);
+        }
+        s->bcast_capacity = size;
+    }
+
+    // Read the whole file once and hand it to all ranks of the scope
+    double t1 = get_time_sec();
+    if (crank == reader)
+        read_whole_file(path, size, r->opt.read_size, s->bcast_mem);
+    double t2 = get_time_sec();
+    if (r->opt.bcast_shm) {
+        MPI_Win_sync(s->bcast_win);
+        MPI_Barrier(comm);
+        MPI_Win_sync(s->bcast_win);
+    } else {
+        bcast_large(s->bcast_mem, size, reader, comm);
+    }
+    double t3 = get_time_sec();
+
+    int retval = nc_open_mem(path, NC_NOWRITE, size, s->bcast_mem, &s->ncid);
+    if (retval != NC_NOERR) {
+        printf("Rank %d: Error opening file %s from memory: %s\n", b->rank, path, nc_strerror(retval));
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    r->stats.phase_times[0] = t2 - t1;
+    r->stats.phase_times[1] = t3 - t2;
+    r->stats.phase_times[2] = get_time_sec() - t3;
+}
+
+static int bcast_read(ddr_reader_t *r, int varid, float *buffer) {
+    double t0 = get_time_sec();
+    int retval = read_layout(r, varid, 1, buffer);
+    r->stats.phase_times[2] += get_time_sec() - t0;
+    return retval;
+}
+
+// Nobody may overwrite the shared copy before all ranks are done with it
+static void bcast_close(ddr_reader_t *r) {
+    struct ddr_state *s = r->state;
+    double t0 = get_time_sec();
+    close_ncid(r);
+    r->stats.phase_times[2] += get_time_sec() - t0;
+    if (s->bcast_win != MPI_WIN_NULL) {
+        MPI_Win_sync(s->bcast_win);
+        MPI_Barrier(s->bcast_comm);
+        MPI_Win_sync(s->bcast_win);
+    }
+}
+
+// Function to find key in JSON text. Returns its value with leading
+// whitespace skipped, or NULL if there is none
+static const char *json_value(const char *text, const char *key) {
+    char quoted[NC_MAX_NAME + 3];
+    snprintf(quoted, sizeof(quoted), "\"%s\"", key);
+    const char *p = strstr(text, quoted);
+    if (p == NULL)
+        return NULL;
+    p += strlen(quoted);
+    p += strspn(p, " \t\r\n");
+    if (*p != ':')
+        return NULL;
+    return p + 1 + strspn(p + 1, " \t\r\n");
+}
+
+// Function to parse the JSON array of sizes at p into out of max entries.
+// Returns the number of entries, -1 if p is no such array
+static int json_sizes(const char *p, size_t *out, int max) {
+    if (p == NULL || *p++ != '[')
+        return -1;
+    for (int n = 0;; n++) {
+        p += strspn(p, " \t\r\n");
+        if (*p == ']' && n == 0)
+            return 0;
+        char *end;
+        unsigned long long v = strtoull(p, &end, 10);
+        if (end == p || n == max)
+            return -1;
+        out[n] = (size_t) v;
+        p = end + strspn(end, " \t\r\n");
+        if (*p == ']')
+            return n + 1;
+        if (*p++ != ',')
+            return -1;
+    }
+}
+
+// Function to parse the JSON array of dimension names at p into the indices
+// of the dimensions of that name in b, out of max entries. Returns the number
+// of entries, -1 if p is no such array or a name is not a dimension of b
+static int json_dims(const char *p, const bench_t *b, int *out, int max) {
+    if (p == NULL || *p++ != '[')
+        return -1;
+    for (int n = 0;; n++) {
+        p += strspn(p, " \t\r\n");
+        if (*p == ']' && n == 0)
+            return 0;
+        const char *end = *p == '"' ? strchr(p + 1, '"') : NULL;
+        if (end == NULL || n == max)
+            return -1;
+        size_t len = end - p - 1;
+        out[n] = -1;
+        for (int d = 0; d < b->ndims; d++)
+            if (strlen(b->dimnames[d]) == len && strncmp(b->dimnames[d], p + 1, len) == 0)
+                out[n] = d;
+        if (out[n] < 0)
+            return -1;
+        p = end + 1 + strspn(end + 1, " \t\r\n");
+        if (*p == ']')
+            return n + 1;
+        if (*p++ != ',')
+            return -1;
+    }
+}
+
+// Function to check that the JSON value at p starts with the string s
+static int json_is(const char *p, const char *s) {
+    return p != NULL && strncmp(p, s, strlen(s)) == 0;
+}
+
+// Function to read the .zarray of variable varid from the open chunk store
+// of a reader into a, checking that it has a layout and codecs the engine can
+// read. The dimensions of the array are mapped to those of the setup by the
+// names in .zattrs (_ARRAY_DIMENSIONS), so arrays may have fewer dimensions
+// than the file; without names, the array must have all file dimensions
+static void zarr_load(ddr_reader_t *r, int varid, zarr_array_t *a) {
+    const bench_t *b = r->b;
+    char path[4096], text[65536];
+    snprintf(path, sizeof(path), "%s/%s/.zarray", r->state->zarr_store, b->varnames[varid]);
+    ssize_t n = read_file(path, text, sizeof(text) - 1);
+    if (n < 0) {
+        printf("Rank %d: Error reading Zarr metadata %s\n", b->rank, path);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    text[n] = '\0';
+    const char *compressor = json_value(text, "compressor");
+    const char *filters = json_value(text, "filters");
+    const char *fill = json_value(text, "fill_value");
+    const char *separator = json_value(text, "dimension_separator");
+    int shuffled = json_is(filters, "[") && json_is(json_value(filters, "id"), "\"shuffle\"")
+                   && json_is(json_value(filters, "elementsize"), "4");
+    a->codec = -1;
+    if (json_is(compressor, "null") && json_is(filters, "null"))
+        a->codec = ZARR_RAW;
+    else if (json_is(compressor, "{") && shuffled && json_is(json_value(compressor, "id"), "\"ddread-lz\""))
+        a->codec = ZARR_SHUFFLE_LZ;
+    else if (json_is(compressor, "{") && shuffled && json_is(json_value(compressor, "id"), "\"lz4\""))
+        a->codec = ZARR_LZ4;
+    a->ndims = json_sizes(json_value(text, "shape"), a->shape, MAX_DIMS);
+    int ok = a->codec >= 0 && zarr_codec_names[a->codec] != NULL
+             && json_is(json_value(text, "zarr_format"), "2") && json_is(json_value(text, "dtype"), "\"<f4\"")
+             && json_is(json_value(text, "order"), "\"C\"") && (separator == NULL || json_is(separator, "\".\""))
+             && a->ndims > 0 && json_sizes(json_value(text, "chunks"), a->chunks, MAX_DIMS) == a->ndims;
+
+    // Dimensions of the array, by name or all in file order
+    char attrs[65536];
+    snprintf(path, sizeof(path), "%s/%s/.zattrs", r->state->zarr_store, b->varnames[varid]);
+    n = read_file(path, attrs, sizeof(attrs) - 1);
+    if (n >= 0) {
+        attrs[n] = '\0';
+        ok = ok && json_dims(json_value(attrs, "_ARRAY_DIMENSIONS"), b, a->dims, MAX_DIMS) == a->ndims;
+    } else {
+        ok = ok && a->ndims == b->ndims;
+        for (int d = 0; ok && d < a->ndims; d++)
+            a->dims[d] = d;
+    }
+    ok = ok && a->ndims == b->var_ndims[varid];
+    for (int d = 0; ok && d < a->ndims; d++)
+        ok = a->dims[d] == b->var_dimids[varid][d] && a->shape[d] == b->dimlen[a->dims[d]] && a->chunks[d] > 0;
+    if (!ok) {
+        snprintf(path, sizeof(path), "%s/%s", r->state->zarr_store, b->varnames[varid]);
+        printf("Rank %d: Zarr array %s is not a float array over the dimensions of its variable with known codecs\n",
+               b->rank, path);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    if (json_is(fill, "\"NaN\""))
+        a->fill = NAN;
+    else if (fill == NULL || json_is(fill, "null"))
+        a->fill = NC_FILL_FLOAT;
+    else
+        a->fill = strtof(fill, NULL);
+}
+
+// Chunk stores of the files in the directory zarr_dir of the options
+static void zarr_setup(ddr_reader_t *r) {
+    reject_layout(r);
+    if (r->b->nsplit > 0) {
+        printf("Error: the zarr engine needs a lat/lon decomposition\n");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    if (r->opt.zarr_dir == NULL || r->opt.zarr_dir[0] == '\0') {
+        printf("Error: the zarr engine needs the zarr_dir option\n");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+}
+
+// Chunk store of the file; no netCDF file is opened, only the metadata of
+// the data variables is read
+static void zarr_open(ddr_reader_t *r, const char *path) {
+    const bench_t *b = r->b;
+    struct ddr_state *s = r->state;
+    char store[4096];
+    zarr_store_path(r->opt.zarr_dir, path, store, sizeof(store));
+    s->zarr_store = strdup(store);
+    s->zarr = (zarr_array_t*) calloc(b->nvars + b->dimvars, sizeof(zarr_array_t));
+    for (int varid = 0; varid < b->nvars + b->dimvars; varid++)
+        if (!b->is_dimvar[varid]) zarr_load(r, varid, &s->zarr[varid]);
+}
+
+// Function to compare chunk indices for qsort
+static int compare_size(const void *a, const void *b) {
+    size_t x = *(const size_t*) a, y = *(const size_t*) b;
+    return (x > y) - (x < y);
+}
+
+// Function to read the pieces of one variable from the chunks intersecting
+// any of them. Each chunk is fetched and decoded once, by one of the OpenMP
+// threads, and copied into every piece it overlaps; missing chunks hold
+// only the fill value. Pieces cover the dimensions of the array only
+static int zarr_read(ddr_reader_t *r, int varid, float *buffer) {
+    const bench_t *b = r->b;
+    const zarr_array_t *a = &r->state->zarr[varid];
+    int nd = a->ndims;
+    size_t grid[MAX_DIMS], n = 1;
+    for (int d = 0; d < nd; d++) {
+        grid[d] = (a->shape[d] + a->chunks[d] - 1) / a->chunks[d];
+        n *= a->chunks[d];
+    }
+
+    // Boxes of the pieces in the buffer and the linear grid indices of the
+    // chunks intersecting them, without duplicates
+    int nboxes = b->var_nboxes[varid];
+    box_t boxes[NPIECES];
+    size_t offsets[NPIECES], lo[NPIECES][MAX_DIMS], hi[NPIECES][MAX_DIMS], off = 0, total = 0;
+    for (int p = 0; p < nboxes; p++) {
+        var_hyperslab(r, varid, p, boxes[p].start, boxes[p].count);
+        offsets[p] = off;
+        off += box_size(nd, &boxes[p]);
+        if (box_size(nd, &boxes[p]) == 0) continue;
+        size_t m = 1;
+        for (int d = 0; d < nd; d++) {
+            lo[p][d] = boxes[p].start[d] / a->chunks[d];
+            hi[p][d] = (boxes[p].start[d] + boxes[p].count[d] - 1) / a->chunks[d];
+            m *= hi[p][d] - lo[p][d] + 1;
+        }
+        total += m;
+    }
+    size_t *ids = (size_t*) malloc((total > 0 ? total : 1) * sizeof(size_t)), nids = 0;
+    for (int p = 0; p < nboxes; p++) {
+        if (box_size(nd, &boxes[p]) == 0) continue;
+        size_t idx[MAX_DIMS];
+        memcpy(idx, lo[p], nd * sizeof(size_t));
+        for (;;) {
+            size_t id = 0;
+            for (int d = 0; d < nd; d++)
+                id = id * grid[d] + idx[d];
+            ids[nids++] = id;
+            int d = nd - 1;
+            while (d >= 0 && ++idx[d] > hi[p][d]) {
+                idx[d] = lo[p][d];
+                d--;
+            }
+            if (d < 0) break;
+        }
+    }
+    qsort(ids, nids, sizeof(size_t), compare_size);
+    size_t m = 0;
+    for (size_t k = 0; k < nids; k++)
+        if (m == 0 || ids[k] != ids[m - 1]) ids[m++] = ids[k];
+
+    size_t raw = n * sizeof(float), cap = zarr_bound(raw), fetched = 0;
+    int status = NC_NOERR;
+#pragma omp parallel reduction(+:fetched)
+    {
+        unsigned char *packed = (unsigned char*) malloc(cap), *planes = (unsigned char*) malloc(raw);
+        float *chunk = (float*) malloc(raw);
+        char path[4096];
+#pragma omp for schedule(dynamic)
+        for (size_t k = 0; k < m; k++) {
+            size_t idx[MAX_DIMS], rest = ids[k];
+            box_t box, region;
+            for (int d = nd - 1; d >= 0; d--) {
+                idx[d] = rest % grid[d];
+                rest /= grid[d];
+                box.start[d] = idx[d] * a->chunks[d];
+                box.count[d] = a->chunks[d];
+            }
+            zarr_chunk_path(r->state->zarr_store, b->varnames[varid], nd, idx, path, sizeof(path));
+            ssize_t got = read_file(path, a->codec == ZARR_RAW ? (void*) chunk : (void*) packed,
+                                    a->codec == ZARR_RAW ? raw : cap);
+            if (got < 0 && errno == ENOENT) {
+                for (size_t i = 0; i < n; i++)
+                    chunk[i] = a->fill;
+            } else if (got < 0 || !zarr_decode(a->codec, packed, got, planes, chunk, n)) {
+#pragma omp atomic write
+                status = got < 0 ? NC_ENOTFOUND : NC_EINVAL;
+                continue;
+            } else {
+                fetched += got;
+            }
+            for (int p = 0; p < nboxes; p++)
+                if (box_intersect(nd, &box, &boxes[p], &region))
+                    box_copy(nd, &region, &box, chunk, &boxes[p], buffer + offsets[p]);
+        }
+        free(packed);
+        free(planes);
+        free(chunk);
+    }
+    free(ids);
+    r->stats.chunks += m;
+    r->stats.chunk_bytes += fetched;
+    return status;
+}
+
+static void zarr_close(ddr_reader_t *r) {
+    struct ddr_state *s = r->state;
+    free(s->zarr_store);
+    free(s->zarr);
+    s->zarr_store = NULL;
+    s->zarr = NULL;
+}
+
+// Registry of the read engines, terminated by an entry without name
+const ddr_engine_t ddr_engines[] = {
+    { "direct", layout_setup, direct_open, direct_read, close_ncid },
+    { "serial", layout_setup, serial_open, serial_read, close_ncid },
+    { "twophase", two_phase_setup, two_phase_open, two_phase_read, close_ncid },
+    { "zarr", zarr_setup, zarr_open, zarr_read, zarr_close },
+    { "hdf5", hdf5_setup, hdf5_open, hdf5_read, hdf5_close },
+    { "bcast", bcast_setup, bcast_open, bcast_read, bcast_close },
+    { NULL, NULL, NULL, NULL, NULL }
+};
+
+// Function to look up a read engine by name. Returns NULL if there is none
+const ddr_engine_t *ddr_find_engine(const char *name) {
+    for (const ddr_engine_t *e = ddr_engines; e->name != NULL; e++)
+        if (strcmp(e->name, name) == 0) return e;
+    return NULL;
+}
+
+// Function to set the engine options to their defaults: file order, one
+// aggregator per node spread over the ranks with 64 MiB blocks aligned to
+// 1 MiB stripes, collective HDF5 metadata reads, and MPI_Bcast of whole files
+// in 64 MiB reads over the communicator of the reader
+void ddr_options_init(ddr_options_t *opt) {
+    memset(opt, 0, sizeof(*opt));
+    opt->mapped = 1;
+    opt->aggr_placement = "spread";
+    opt->cb_buffer = (size_t) 64 << 20;
+    opt->stripe_size = (size_t) 1 << 20;
+    opt->coll_metadata = 1;
+    opt->bcast_comm = MPI_COMM_NULL;
+    opt->read_size = (size_t) 64 << 20;
+}
+
+// Function to set up a reader of the subdomain of b on comm with the options
+// opt (NULL for the defaults). The hyperslab covers all non-decomposed
+// dimensions fully until the caller narrows it. The engine checks the options
+// and builds its state on the first ddr_open
+void ddr_reader_init(ddr_reader_t *r, const ddr_engine_t *engine, const bench_t *b, MPI_Comm comm,
+                     const ddr_options_t *opt) {
+    memset(r, 0, sizeof(*r));
+    r->engine = engine;
+    r->b = b;
+    r->comm = comm;
+    if (opt != NULL)
+        r->opt = *opt;
+    else
+        ddr_options_init(&r->opt);
+    r->start = (size_t*) malloc(b->ndims * sizeof(size_t));
+    r->count = (size_t*) malloc(b->ndims * sizeof(size_t));
+    for (int d = 0; d < b->ndims; d++) {
+        r->start[d] = 0;
+        r->count[d] = b->dimlen[d];
+    }
+    r->state = (struct ddr_state*) calloc(1, sizeof(struct ddr_state));
+    r->state->ncid = -1;
+    r->state->h5_file = -1;
+    r->state->bcast_win = MPI_WIN_NULL;
+}
+
+// Function to free a reader; an open file or store is closed first. The
+// shared window of the bcast engine is freed collectively over its
+// communicator
+void ddr_reader_free(ddr_reader_t *r) {
+    struct ddr_state *s = r->state;
+    if (s->ncid >= 0 || s->zarr_store != NULL || s->h5_file >= 0)
+        ddr_close(r);
+    if (s->bcast_win != MPI_WIN_NULL) {
+        MPI_Win_unlock_all(s->bcast_win);
+        MPI_Win_free(&s->bcast_win);
+    } else {
+        free(s->bcast_mem);
+    }
+    if (s->tp != NULL) {
+        two_phase_free(s->tp);
+        free(s->tp);
+    }
+    free(s->scratch);
+    free(s);
+    free(r->start);
+    free(r->count);
+}
+
+// Function to open a file with the engine of the reader. The first open sets
+// up the engine, which stops with an error on missing or invalid options
+void ddr_open(ddr_reader_t *r, const char *path) {
+    if (r->engine == NULL) {
+        printf("Error: reader without engine\n");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    if (!r->state->is_setup) {
+        if (r->engine->setup != NULL)
+            r->engine->setup(r);
+        r->state->is_setup = 1;
+    }
+    memset(&r->stats, 0, sizeof(r->stats));
+    r->engine->open(r, path);
+}
+
+// Function to read the subdomain of one variable straight into the
+// caller-owned buffer of at least b->bufsize floats, one piece after the other
+// in the target layout of the reader. Returns a netCDF status
+int ddr_read(ddr_reader_t *r, int varid, float *buffer) {
+    return r->engine->read(r, varid, buffer);
+}
+
+// Function to close the file opened by ddr_open
+void ddr_close(ddr_reader_t *r) {
+    r->engine->close(r);
+}
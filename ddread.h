@@ -0,0 +1,139 @@
+// Subdomain reader library: domain decomposition, metadata discovery and read
+// engines, reusable by models that read their subdomain straight into their
+// own buffers. The helpers behind the engines and the benchmark modes of
+// netcdf_dd_read_bench are declared in ddbench.h
+#ifndef DDREAD_H
+#define DDREAD_H
+
+#include <mpi.h>
+#include <netcdf.h>
+#include <stddef.h>
+
+// Maximum number of dimensions of a variable handled by the library
+#define MAX_DIMS 16
+
+// Pieces of a subdomain in the lat/lon plane. Each piece is read with its own
+// hyperslab and stored back to back in the read buffer
+enum { PIECE_INTERIOR = 0, PIECE_LEFT_WRAP, PIECE_RIGHT_WRAP, NPIECES };
+
+typedef struct {
+    int lat0, nlat;
+    int lon0, nlon;
+} piece_t;
+
+// Hyperslab in the index space of a variable; arrays described by a box are
+// stored row-major with the last dimension varying fastest
+typedef struct {
+    size_t start[MAX_DIMS];
+    size_t count[MAX_DIMS];
+} box_t;
+
+// Decomposed dimension of the N-dimensional decomposition
+typedef struct {
+    char name[NC_MAX_NAME + 1];
+    int nproc;     // Ranks along the dimension
+    int halo;      // Halo width on both sides
+    int periodic;  // Halo wraps around at the domain boundaries
+} split_dim_t;
+
+// Setup of the subdomain reads: the metadata found by ddr_scan and the
+// decomposition of ddr_decompose or ddr_decompose_nd. The file list, buffer
+// and file size are only used by the benchmark modes (ddbench.h)
+typedef struct {
+    int rank, nprocs;
+    int nproc_x, nproc_y, halo;
+    int use_independent;
+    int nfiles;
+    char **file_list;
+    int ndims, nvars, dimvars;  // nvars counts data variables only
+    size_t *dimlen;
+    char (*dimnames)[NC_MAX_NAME + 1];
+    int *is_dimvar;
+    char (*varnames)[NC_MAX_NAME + 1];
+    int *var_ndims;             // Dimensions of each variable, by varid
+    int (*var_dimids)[MAX_DIMS];
+    int lat_idx, lon_idx;
+    piece_t pieces[NPIECES];    // Subdomain of this rank in the lat/lon plane,
+    int npieces;                // none for an N-d decomposition
+    int nsplit;                 // Decomposed dimensions of ddr_decompose_nd, 0 for lat/lon
+    int *is_split;              // Per dimension: decomposed
+    int *var_nboxes;            // Subdomain of each data variable as boxes in its
+    box_t **var_boxes;          // own index space, stored back to back, by varid
+    size_t bufsize;             // Size of buffer in floats for the largest variable
+    float *buffer;
+    size_t file_bytes;
+} bench_t;
+
+// Reader of the subdomain of a setup with one of the registered engines:
+// ddr_open, ddr_read for every variable, ddr_close for each file
+typedef struct ddr_reader ddr_reader_t;
+
+typedef struct {
+    const char *name;
+    void (*setup)(ddr_reader_t *r);     // Check the options and build the engine
+                                        // state on the first ddr_open, or NULL
+    void (*open)(ddr_reader_t *r, const char *path);
+    int (*read)(ddr_reader_t *r, int varid, float *buffer);
+    void (*close)(ddr_reader_t *r);
+} ddr_engine_t;
+
+// Options of the engines, set to their defaults by ddr_options_init. Each
+// engine reads only its own fields
+typedef struct {
+    size_t readahead;           // serial: read buffer size hint, 0 for the default
+    const int *layout;          // direct, serial, bcast: target dimension order,
+                                // NULL for the file order
+    int mapped;                 // Map reads into the layout with nc_get_varm_float
+                                // instead of reading and transposing
+    int naggr;                  // twophase: number of aggregators, 0 for one per node
+    const char *aggr_placement; // twophase: spread, packed or node
+    size_t cb_buffer;           // twophase: block size per aggregator in bytes
+    size_t stripe_size;         // twophase: stripe alignment of contiguous
+                                // variables in bytes, 0 to disable
+    const char *zarr_dir;       // zarr: directory of the chunk stores (required)
+    int coll_metadata;          // hdf5: collective metadata reads
+    int sparse;                 // hdf5: skip unallocated chunks
+    MPI_Comm bcast_comm;        // bcast: ranks sharing each read, MPI_COMM_NULL
+                                // for the communicator of the reader
+    int bcast_shm;              // bcast: share through a node-local window
+                                // instead of MPI_Bcast
+    size_t read_size;           // bcast: size of the sequential reads of whole files
+    int verbose;                // Print the engine setup from rank 0
+} ddr_options_t;
+
+// Counters of the reads since ddr_open
+typedef struct {
+    double transpose_time;      // Time spent transposing into the layout
+    size_t chunks;              // zarr: chunks fetched
+    size_t chunk_bytes;         // zarr: chunk file bytes fetched
+    size_t skipped;             // hdf5: bytes of unallocated chunks skipped
+    double phase_times[3];      // bcast: read, distribute and extract
+} ddr_stats_t;
+
+struct ddr_reader {
+    const ddr_engine_t *engine;
+    const bench_t *b;
+    MPI_Comm comm;
+    ddr_options_t opt;
+    size_t *start, *count;      // Hyperslab of the non-decomposed dimensions
+    ddr_stats_t stats;
+    struct ddr_state *state;    // Open file and engine state, private to ddread.c
+};
+
+extern const ddr_engine_t ddr_engines[];
+
+void ddr_scan(int ncid, const char *lon_name, const char *lat_name, bench_t *b);
+void ddr_decompose(bench_t *b, int nproc_x, int nproc_y, int halo);
+void ddr_decompose_nd(bench_t *b, const split_dim_t *split, int nsplit);
+int ddr_full_vars(const bench_t *b);
+void ddr_free(bench_t *b);
+const ddr_engine_t *ddr_find_engine(const char *name);
+void ddr_options_init(ddr_options_t *opt);
+void ddr_reader_init(ddr_reader_t *r, const ddr_engine_t *engine, const bench_t *b, MPI_Comm comm,
+                     const ddr_options_t *opt);
+void ddr_reader_free(ddr_reader_t *r);
+void ddr_open(ddr_reader_t *r, const char *path);
+int ddr_read(ddr_reader_t *r, int varid, float *buffer);
+void ddr_close(ddr_reader_t *r);
+
+#endif
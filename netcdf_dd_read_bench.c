@@ -1,293 +1,1599 @@
 // Include necessary libraries for MPI, netCDF, and other utilities
-#include <mpi.h>
-#include <netcdf.h>
-#include <netcdf_par.h>
-#include <math.h>
+#include "ddbench.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/time.h>
 #include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
-// Function to get the current time in seconds for performance measurement
-double get_time_sec() {
-    struct timeval tv;
-    gettimeofday(&tv, NULL);
-    return tv.tv_sec + 1e-6 * tv.tv_usec;
+// Function to extract an optional "--name=value" argument from the command line.
+// Matching arguments are removed from argv so that the positional arguments
+// keep their meaning. Returns def if the option is not given
+const char *get_option(int *argc, char **argv, const char *name, const char *def) {
+    size_t len = strlen(name);
+    const char *value = def;
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0 && strncmp(argv[i] + 2, name, len) == 0
+            && argv[i][2 + len] == '=') {
+            value = argv[i] + 3 + len;
+            for (int j = i; j < *argc - 1; j++)
+                argv[j] = argv[j + 1];
+            (*argc)--;
+            i--;
+        }
+    }
+    return value;
 }
 
-// Function to safely abort MPI processes in case of errors
-void safe_abort(MPI_Comm comm, int errorcode) {
-    fflush(stdout);
-    fflush(stderr);
-    usleep(100000); // 100ms delay to flush output buffers
-    MPI_Abort(comm, errorcode);
+// Function to parse a size in bytes with an optional K, M or G suffix
+size_t parse_size(const char *str) {
+    char *end;
+    double value = strtod(str, &end);
+    switch (*end) {
+        case 'k': case 'K': value *= 1024.0; break;
+        case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+        case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+    }
+    return (size_t) value;
 }
 
-int main(int argc, char **argv) {
-    // Initialize MPI and get rank and size
-    int rank, nprocs;
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+// Read modes selected with --mode
+enum { MODE_DIRECT = 0, MODE_TWO_PHASE, MODE_FILE_PARALLEL, MODE_BCAST, MODE_SERIAL, MODE_HDF5,
+       MODE_METADATA, MODE_STEAL, MODE_IOSERVER, MODE_ENSEMBLE,
+       MODE_INTERFERENCE, MODE_ND, MODE_ZARR, NMODES };
+const char *mode_names[NMODES] = { "direct", "twophase", "fileparallel", "bcast", "serial", "hdf5",
+                                   "metadata", "steal", "ioserver", "ensemble",
+                                   "interference", "nd", "zarr" };
+
+// Function to print the command line usage
+static void print_usage(const char *prog) {
+    printf("Usage: %s [options] <halo> <nproc_x> <nproc_y> <use_independent> <xdim_name> <ydim_name> <file1.nc> [file2.nc ...]\n", prog);
+    printf("Options:\n");
+    printf("  --mode=MODE                 direct, twophase, fileparallel, bcast, serial, hdf5, metadata, steal\n");
+    printf("                              ioserver, ensemble, interference, nd or zarr (default: direct)\n");
+    printf("  --aggregators=N             number of two-phase aggregators (default: one per node)\n");
+    printf("  --aggr-placement=P          spread, packed or node (default: spread)\n");
+    printf("  --cb-buffer=SIZE            two-phase block size per aggregator (default: 64M)\n");
+    printf("  --stripe-size=SIZE          file stripe alignment of contiguous variables, 0 to disable (default: 1M)\n");
+    printf("  --file-groups=G             number of rank groups reading different files (default: 2)\n");
+    printf("  --redistribute=0|1          ship file-parallel reads to the subdomain owners (default: 1)\n");
+    printf("  --bcast-scope=node|world    one reader per node or per file over all ranks (default: node)\n");
+    printf("  --bcast-method=bcast|shm    distribute with MPI_Bcast or node-local shared memory (default: bcast)\n");
+    printf("  --read-size=SIZE            size of the sequential reads of whole files (default: 64M)\n");
+    printf("  --readahead=SIZE            read buffer size hint for serial opens, 0 for the default (default: 0)\n");
+    printf("  --coll-metadata=0|1         collective HDF5 metadata reads in hdf5 mode (default: 1)\n");
+    printf("  --sparse=0|1                skip unallocated chunks in hdf5 mode and compare with plain reads (default: 0)\n");
+    printf("  --meta-comm-size=S          ranks per collective open in metadata mode (default: all ranks)\n");
+    printf("  --meta-repeat=R             passes over the file list in metadata mode (default: 10)\n");
+    printf("  --meta-stagger=USEC         delay between the opens of successive groups (default: 0)\n");
+    printf("  --throttle=K                at most K concurrent readers per scope, 0 to disable (default: 0)\n");
+    printf("  --throttle-scope=S          global or node (default: global)\n");
+    printf("  --throttle-method=M         rma (ticket counter) or ring (point-to-point) (default: rma)\n");
+    printf("  --tiles=T                   read tasks per subdomain piece and variable in steal mode (default: 4)\n");
+    printf("  --steal=0|1                 steal tasks from other ranks or run them statically (default: 1)\n");
+    printf("  --io-servers=M              I/O server ranks in ioserver mode, in addition to the grid (default: 1)\n");
+    printf("  --compute-time=SEC          synthetic compute load per file on the compute ranks (default: 1.0)\n");
+    printf("  --members=E                 ensemble members sharing the decomposition (default: 2)\n");
+    printf("  --shared-read=0|1           one reading member broadcasting to the others (default: 1)\n");
+    printf("  --jobs=J                    concurrent reader jobs in interference mode (default: 2)\n");
+    printf("  --job-files=F               overlap (all jobs read all files) or disjoint (default: overlap)\n");
+    printf("  --job-offset=USEC           delay between the starts of successive jobs (default: 0)\n");
+    printf("  --level-dim=NAME            dimension restricted by --level-range (default: none)\n");
+    printf("  --level-range=LO:HI         inclusive level window in direct and serial mode\n");
+    printf("  --level-by=index|value      LO and HI are indices or coordinate values (default: index)\n");
+    printf("  --request-cost=SIZE         bytes one read request is worth when scoring grids for\n");
+    printf("                              nproc_x = nproc_y = 0 (default: 256K)\n");
+    printf("  --grid-trials=K             read the first file with the K best grids (default: 0)\n");
+    printf("  --decomp=NAME:NPROC[:HALO[:periodic]],...\n");
+    printf("                              decomposed dimensions in nd mode (default: the positional\n");
+    printf("                              grid, periodic in xdim); replaces the positional grid and halo\n");
+    printf("  --layout=DIM,DIM,...        target order of all dimensions, slowest first, in direct\n");
+    printf("                              and serial mode (default: file order)\n");
+    printf("  --layout-method=M           mapped (nc_get_varm_float) or transpose (default: mapped)\n");
+    printf("  --transform=T               post-read transform: none, columns, interleave or both\n");
+    printf("                              (default: none)\n");
+    printf("  --column-dim=NAME           dimension made fastest by --transform=columns (default: lev)\n");
+    printf("  --probe-points=N            interpolation points per probe of the transform (default: 100000)\n");
+    printf("  --interp=N                  particles per rank interpolated between consecutive files in every\n");
+    printf("                              layout, 0 to disable (default: 0)\n");
+    printf("  --particles=P               random, clustered or sorted particle positions (default: random)\n");
+    printf("  --tile=E                    also interpolate in Morton-ordered tiles of ExExE elements, E a\n");
+    printf("                              power of two, 0 to disable (default: 0)\n");
+    printf("  --half=H                    also keep the fields as fp16, bf16 or both and interpolate from\n");
+    printf("                              them, none to disable (default: none)\n");
+    printf("  --store=C                   also keep the tiles compressed with shuffle-lz or lz4 (built with\n");
+    printf("                              -DHAVE_LZ4) and interpolate through an LRU, none to disable\n");
+    printf("                              (default: none)\n");
+    printf("  --store-cache=N             decompressed tiles in the LRU of --store (default: 64)\n");
+    printf("  --delta-cache=DIR           also write the subdomain of each file to a rank-local cache in DIR\n");
+    printf("                              as keyframes and deltas and read it back, in direct, serial or\n");
+    printf("                              twophase mode without --layout\n");
+    printf("  --keyframe=K                steps per keyframe of --delta-cache (default: 8)\n");
+    printf("  --delta-quant=Q             quantisation step of the deltas, 0 for exact deltas (default: 0)\n");
+    printf("  --zarr-dir=DIR              directory of the Zarr chunk stores read in zarr mode\n");
+    printf("  --zarr-convert=0|1          convert the files into chunk stores before reading (default: 0)\n");
+    printf("  --zarr-codec=C              chunk codec of the conversion: none, shuffle-lz or lz4 (built with\n");
+    printf("                              -DHAVE_LZ4) (default: shuffle-lz)\n");
+    printf("  --zarr-chunk=N              lat/lon chunk edge of the conversion, 0 for the netCDF chunks\n");
+    printf("                              (default: 0)\n");
+}
+
+// Function to read the subdomains of all files with the serial engine and
+// record the time of each file, for comparison with the zarr engine
+static void time_netcdf_reads(const bench_t *b, double *netcdf_times) {
+    ddr_reader_t nc_reader;
+    ddr_reader_init(&nc_reader, ddr_find_engine("serial"), b, MPI_COMM_WORLD, NULL);
+    for (int f = 0; f < b->nfiles; f++) {
+        ddr_open(&nc_reader, b->file_list[f]);
+        double file_start = get_time_sec();
+        for (int varid = 0; varid < b->nvars+b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            int retval = ddr_read(&nc_reader, varid, b->buffer);
+            if (retval != NC_NOERR) {
+                printf("Rank %d: Error reading subdomain for var %d: %s\n", b->rank, varid, nc_strerror(retval));
+                safe_abort(MPI_COMM_WORLD, 1);
+            }
+            b->buffer[0] *= 3.4;
+        }
+        ddr_close(&nc_reader);
+        MPI_Barrier(MPI_COMM_WORLD);
+        netcdf_times[f] = get_time_sec() - file_start;
+    }
+    ddr_reader_free(&nc_reader);
+}
+
+// Options of the command line, completed by setup_bench with the settings
+// found in the first file
+typedef struct {
+    int read_mode;                  // Index into mode_names
+    int halo, nproc_x, nproc_y;     // Positional grid, or the grid chosen by setup_bench
+    int use_independent;
+    const char *lon_name, *lat_name;
+    int nfiles;
+    char **file_list;
+    int auto_grid;                  // Grid chosen from the layout (nproc_x = nproc_y = 0)
+    int nservers, nmembers;         // I/O server ranks, and members or jobs sharing the ranks
+    split_dim_t split[MAX_DIMS];    // N-D decomposition of nd mode
+    int nsplit;
+    // Engine and mode settings
+    int naggr;
+    const char *aggr_placement;
+    size_t cb_buffer, stripe_size;
+    int file_groups, redistribute;
+    const char *bcast_scope, *bcast_method;
+    int bcast_node_scope, bcast_use_shm;
+    size_t read_size, readahead;
+    int coll_metadata, sparse;
+    int meta_comm_size, meta_repeat, meta_stagger;
+    int throttle_k;
+    const char *throttle_scope, *throttle_method;
+    int throttle_node_scope, throttle_ring;
+    int steal_tiles, steal;
+    int io_servers;
+    double compute_time;
+    int members, shared_read;
+    int jobs, job_overlap, job_offset;
+    const char *job_files;
+    double request_cost;
+    int grid_trials;
+    // Level window and target layout
+    const char *level_dim, *level_range;
+    int use_levels, level_by_value;
+    const char *layout, *layout_method;
+    int use_layout, layout_mapped;
+    // Post-read steps of the engine modes
+    const char *transform, *column_dim;
+    int transform_cols, transform_inter, use_transform, probe_points;
+    long interp_n;
+    const char *particles;
+    int particle_dist, tile_edge;
+    int use_half[NPRECISIONS];
+    int codec, use_store, store_cache;
+    const char *delta_dir;
+    int use_delta, keyframe;
+    float delta_quant;
+    int keep_fields;                // All variables of a file kept for the post-read steps
+    const char *zarr_dir, *zarr_codec;
+    int zarr_convert_files, zarr_codec_id, zarr_chunk;
+    // Found in the first file
+    int level_idx;                  // Level window, -1 without --level-dim
+    size_t level0, nlevel;
+    int layout_perm[MAX_DIMS];      // Order of the dimensions in the read buffer
+    int column_idx;                 // Vertical dimension of the post-read steps, -1 if unused
+} bench_opts_t;
+
+// Function to parse and check the options and positional arguments. Errors
+// are printed from rank 0; returns nonzero if the benchmark cannot run
+static int parse_options(int *argc, char **argv, int rank, int nprocs, bench_opts_t *o) {
+    memset(o, 0, sizeof(*o));
+    const char *mode = get_option(argc, argv, "mode", "direct");
+    o->naggr = atoi(get_option(argc, argv, "aggregators", "0"));
+    o->aggr_placement = get_option(argc, argv, "aggr-placement", "spread");
+    o->cb_buffer = parse_size(get_option(argc, argv, "cb-buffer", "64M"));
+    o->stripe_size = parse_size(get_option(argc, argv, "stripe-size", "1M"));
+    o->file_groups = atoi(get_option(argc, argv, "file-groups", "2"));
+    o->redistribute = atoi(get_option(argc, argv, "redistribute", "1"));
+    o->bcast_scope = get_option(argc, argv, "bcast-scope", "node");
+    o->bcast_method = get_option(argc, argv, "bcast-method", "bcast");
+    o->read_size = parse_size(get_option(argc, argv, "read-size", "64M"));
+    o->readahead = parse_size(get_option(argc, argv, "readahead", "0"));
+    o->coll_metadata = atoi(get_option(argc, argv, "coll-metadata", "1"));
+    o->sparse = atoi(get_option(argc, argv, "sparse", "0"));
+    o->meta_comm_size = atoi(get_option(argc, argv, "meta-comm-size", "0"));
+    o->meta_repeat = atoi(get_option(argc, argv, "meta-repeat", "10"));
+    o->meta_stagger = atoi(get_option(argc, argv, "meta-stagger", "0"));
+    o->throttle_k = atoi(get_option(argc, argv, "throttle", "0"));
+    o->throttle_scope = get_option(argc, argv, "throttle-scope", "global");
+    o->throttle_method = get_option(argc, argv, "throttle-method", "rma");
+    o->steal_tiles = atoi(get_option(argc, argv, "tiles", "4"));
+    o->steal = atoi(get_option(argc, argv, "steal", "1"));
+    o->io_servers = atoi(get_option(argc, argv, "io-servers", "1"));
+    o->compute_time = atof(get_option(argc, argv, "compute-time", "1.0"));
+    o->members = atoi(get_option(argc, argv, "members", "2"));
+    o->shared_read = atoi(get_option(argc, argv, "shared-read", "1"));
+    o->jobs = atoi(get_option(argc, argv, "jobs", "2"));
+    o->job_files = get_option(argc, argv, "job-files", "overlap");
+    o->job_offset = atoi(get_option(argc, argv, "job-offset", "0"));
+    o->level_dim = get_option(argc, argv, "level-dim", "");
+    o->level_range = get_option(argc, argv, "level-range", "");
+    const char *level_by = get_option(argc, argv, "level-by", "index");
+    o->request_cost = (double) parse_size(get_option(argc, argv, "request-cost", "256K"));
+    o->grid_trials = atoi(get_option(argc, argv, "grid-trials", "0"));
+    const char *decomp = get_option(argc, argv, "decomp", "");
+    o->layout = get_option(argc, argv, "layout", "");
+    o->layout_method = get_option(argc, argv, "layout-method", "mapped");
+    o->transform = get_option(argc, argv, "transform", "none");
+    o->column_dim = get_option(argc, argv, "column-dim", "lev");
+    o->probe_points = atoi(get_option(argc, argv, "probe-points", "100000"));
+    o->interp_n = atol(get_option(argc, argv, "interp", "0"));
+    o->particles = get_option(argc, argv, "particles", "random");
+    o->tile_edge = atoi(get_option(argc, argv, "tile", "0"));
+    const char *half = get_option(argc, argv, "half", "none");
+    const char *store_codec = get_option(argc, argv, "store", "none");
+    o->store_cache = atoi(get_option(argc, argv, "store-cache", "64"));
+    o->delta_dir = get_option(argc, argv, "delta-cache", "");
+    o->keyframe = atoi(get_option(argc, argv, "keyframe", "8"));
+    o->delta_quant = (float) atof(get_option(argc, argv, "delta-quant", "0"));
+    o->zarr_dir = get_option(argc, argv, "zarr-dir", "");
+    o->zarr_convert_files = atoi(get_option(argc, argv, "zarr-convert", "0"));
+    o->zarr_codec = get_option(argc, argv, "zarr-codec", "shuffle-lz");
+    o->zarr_chunk = atoi(get_option(argc, argv, "zarr-chunk", "0"));
+    for (int i = 1; i < *argc; i++) {
+        if (strncmp(argv[i], "--", 2) == 0) {
+            if (rank == 0)
+                printf("Error: unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    while (o->read_mode < NMODES && strcmp(mode, mode_names[o->read_mode]) != 0)
+        o->read_mode++;
+    if (o->read_mode == NMODES) {
+        if (rank == 0)
+            printf("Error: unknown mode %s\n", mode);
+        return 1;
+    }
+    int read_mode = o->read_mode;
 
     // Check for correct number of arguments
-    if (argc < 8) {
+    if (*argc < 8) {
         if (rank == 0)
-            printf("Usage: %s <halo> <nproc_x> <nproc_y> <use_independent> <xdim_name> <ydim_name> <file1.nc> [file2.nc ...]\n", argv[0]);
-        MPI_Finalize();
+            print_usage(argv[0]);
         return 1;
     }
 
     // Parse command-line arguments
-    int halo = atoi(argv[1]);
-    int nproc_x = atoi(argv[2]);
-    int nproc_y = atoi(argv[3]);
-    int use_independent = atoi(argv[4]);
-    char *lon_name = argv[5];
-    char *lat_name = argv[6];
-    int nfiles = argc - 7;
-    char **file_list = &argv[7];
-
-    // Ensure the number of processes matches the decomposition grid
-    if (nprocs != nproc_x * nproc_y) {
+    o->halo = atoi(argv[1]);
+    o->nproc_x = atoi(argv[2]);
+    o->nproc_y = atoi(argv[3]);
+    o->use_independent = atoi(argv[4]);
+    o->lon_name = argv[5];
+    o->lat_name = argv[6];
+    o->nfiles = *argc - 7;
+    o->file_list = &argv[7];
+
+    // An explicit N-D decomposition replaces the positional grid
+    if (read_mode == MODE_ND && decomp[0] != '\0') {
+        o->nsplit = parse_decomp(decomp, o->split, MAX_DIMS);
+        int nsplit_procs = 1;
+        for (int i = 0; i < o->nsplit; i++)
+            nsplit_procs *= o->split[i].nproc;
+        if (o->nsplit < 1 || nsplit_procs != nprocs) {
+            if (rank == 0)
+                printf("Error: invalid decomposition %s for %d ranks\n", decomp, nprocs);
+            return 1;
+        }
+    }
+    if (decomp[0] != '\0' && read_mode != MODE_ND) {
         if (rank == 0)
-            printf("Error: nprocs != nproc_x * nproc_y\n");
-        MPI_Finalize();
+            printf("Error: --decomp requires nd mode\n");
+        return 1;
+    }
+
+    // Ensure the number of processes matches the decomposition grid (once
+    // per ensemble member or job, plus the I/O servers, which hold no subdomain)
+    if (read_mode == MODE_IOSERVER && (o->io_servers < 1 || o->compute_time < 0.0)) {
+        if (rank == 0)
+            printf("Error: --io-servers must be positive and --compute-time non-negative\n");
+        return 1;
+    }
+    if (read_mode == MODE_ENSEMBLE && o->members < 1) {
+        if (rank == 0)
+            printf("Error: --members must be positive\n");
+        return 1;
+    }
+    o->job_overlap = strcmp(o->job_files, "overlap") == 0;
+    if (read_mode == MODE_INTERFERENCE && (o->jobs < 1 || o->job_offset < 0
+                                           || (!o->job_overlap && strcmp(o->job_files, "disjoint") != 0)
+                                           || (!o->job_overlap && o->nfiles < o->jobs))) {
+        if (rank == 0)
+            printf("Error: invalid interference settings (disjoint file sets need at least one file per job)\n");
+        return 1;
+    }
+    o->nservers = (read_mode == MODE_IOSERVER) ? o->io_servers : 0;
+    o->nmembers = (read_mode == MODE_ENSEMBLE) ? o->members : (read_mode == MODE_INTERFERENCE) ? o->jobs : 1;
+    // With nproc_x = nproc_y = 0 the grid is chosen once the layout is known.
+    // An explicit N-D decomposition ignores the positional grid
+    o->auto_grid = (o->nsplit == 0 && o->nproc_x == 0 && o->nproc_y == 0);
+    if (o->nsplit > 0) {
+        o->nproc_x = o->nproc_y = 1;
+        o->halo = 0;
+    } else if (o->auto_grid && (nprocs - o->nservers) % o->nmembers == 0 && nprocs > o->nservers) {
+        if (o->grid_trials > 0 && (o->nservers > 0 || o->nmembers > 1)) {
+            if (rank == 0)
+                printf("Error: --grid-trials requires all ranks in the process grid\n");
+            return 1;
+        }
+    } else if (o->auto_grid || nprocs != o->nproc_x * o->nproc_y * o->nmembers + o->nservers) {
+        if (rank == 0)
+            printf("Error: nprocs != nproc_x * nproc_y%s%s\n",
+                   read_mode == MODE_ENSEMBLE ? " * members" : read_mode == MODE_INTERFERENCE ? " * jobs" : "",
+                   o->nservers > 0 ? " + io_servers" : "");
         return 1;
     }
 
     // For 1x1 domains, force halo to be 0 to avoid problems
-    if (nproc_x == 1 && nproc_y == 1 && halo > 0) {
+    if (o->nsplit == 0 && (nprocs - o->nservers) / o->nmembers == 1 && o->halo > 0) {
         if (rank == 0)
             printf("Warning: 1x1 domain decomposition detected, forcing halo=0\n");
-        halo = 0;
+        o->halo = 0;
+    }
+
+    if (o->meta_comm_size <= 0 || o->meta_comm_size > nprocs)
+        o->meta_comm_size = nprocs;
+    if (read_mode == MODE_METADATA && (o->meta_repeat < 1 || o->meta_stagger < 0)) {
+        if (rank == 0)
+            printf("Error: --meta-repeat must be positive and --meta-stagger non-negative\n");
+        return 1;
+    }
+
+    o->throttle_node_scope = strcmp(o->throttle_scope, "node") == 0;
+    o->throttle_ring = strcmp(o->throttle_method, "ring") == 0;
+    if (o->throttle_k > 0 && ((!o->throttle_node_scope && strcmp(o->throttle_scope, "global") != 0)
+                              || (!o->throttle_ring && strcmp(o->throttle_method, "rma") != 0))) {
+        if (rank == 0)
+            printf("Error: unknown throttle scope %s or method %s\n", o->throttle_scope, o->throttle_method);
+        return 1;
+    }
+    // Throttled ranks cannot take part in collective reads
+    if (o->throttle_k > 0 && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL)
+                              || (read_mode == MODE_DIRECT && !o->use_independent))) {
+        if (rank == 0)
+            printf("Error: --throttle requires independent reads in direct or serial mode\n");
+        return 1;
+    }
+
+    if (read_mode == MODE_STEAL && o->steal_tiles < 1) {
+        if (rank == 0)
+            printf("Error: --tiles must be positive\n");
+        return 1;
+    }
+
+    o->use_levels = o->level_dim[0] != '\0';
+    o->level_by_value = strcmp(level_by, "value") == 0;
+    if (o->use_levels && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL) || o->level_range[0] == '\0'
+                          || (!o->level_by_value && strcmp(level_by, "index") != 0))) {
+        if (rank == 0)
+            printf("Error: --level-dim requires --level-range and direct or serial mode\n");
+        return 1;
+    }
+
+    o->use_layout = o->layout[0] != '\0';
+    o->layout_mapped = strcmp(o->layout_method, "mapped") == 0;
+    if (o->use_layout && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL)
+                          || (!o->layout_mapped && strcmp(o->layout_method, "transpose") != 0))) {
+        if (rank == 0)
+            printf("Error: --layout requires direct or serial mode and --layout-method=mapped|transpose\n");
+        return 1;
+    }
+
+    o->transform_cols = strcmp(o->transform, "columns") == 0 || strcmp(o->transform, "both") == 0;
+    o->transform_inter = strcmp(o->transform, "interleave") == 0 || strcmp(o->transform, "both") == 0;
+    o->use_transform = o->transform_cols || o->transform_inter;
+    if ((!o->use_transform && strcmp(o->transform, "none") != 0)
+        || (o->use_transform && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL && read_mode != MODE_TWO_PHASE)
+                                 || o->use_layout || o->probe_points < 1))) {
+        if (rank == 0)
+            printf("Error: --transform must be none, columns, interleave or both, in direct, serial or\n"
+                   "twophase mode without --layout\n");
+        return 1;
+    }
+
+    while (o->particle_dist < NPARTICLES && strcmp(o->particles, particle_names[o->particle_dist]) != 0)
+        o->particle_dist++;
+    if (o->interp_n < 0 || o->particle_dist == NPARTICLES
+        || (o->interp_n > 0 && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL && read_mode != MODE_TWO_PHASE)
+                                || o->use_layout))) {
+        if (rank == 0)
+            printf("Error: --interp requires direct, serial or twophase mode without --layout and\n"
+                   "--particles=random|clustered|sorted\n");
+        return 1;
+    }
+    int tile_edge = o->tile_edge;
+    if (tile_edge != 0 && (o->interp_n == 0 || tile_edge < 2 || tile_edge > 64 || (tile_edge & (tile_edge - 1)) != 0)) {
+        if (rank == 0)
+            printf("Error: --tile requires --interp and a power of two between 2 and 64\n");
+        return 1;
+    }
+    o->use_half[PRECISION_FP16] = strcmp(half, "fp16") == 0 || strcmp(half, "both") == 0;
+    o->use_half[PRECISION_BF16] = strcmp(half, "bf16") == 0 || strcmp(half, "both") == 0;
+    if ((!o->use_half[PRECISION_FP16] && !o->use_half[PRECISION_BF16] && strcmp(half, "none") != 0)
+        || (strcmp(half, "none") != 0 && o->interp_n == 0)) {
+        if (rank == 0)
+            printf("Error: --half must be none, fp16, bf16 or both, and requires --interp\n");
+        return 1;
+    }
+    while (o->codec < NCODECS && (codec_names[o->codec] == NULL || strcmp(store_codec, codec_names[o->codec]) != 0))
+        o->codec++;
+    o->use_store = strcmp(store_codec, "none") != 0;
+    if (o->use_store && (o->codec == NCODECS || tile_edge == 0 || o->store_cache < 1)) {
+        if (rank == 0)
+            printf("Error: --store must be none, shuffle-lz or lz4 (built with -DHAVE_LZ4), requires --tile,\n"
+                   "and --store-cache must be positive\n");
+        return 1;
+    }
+    o->use_delta = o->delta_dir[0] != '\0';
+    if (o->use_delta && ((read_mode != MODE_DIRECT && read_mode != MODE_SERIAL && read_mode != MODE_TWO_PHASE)
+                         || o->use_layout || o->keyframe < 1 || o->delta_quant < 0.0f)) {
+        if (rank == 0)
+            printf("Error: --delta-cache requires direct, serial or twophase mode without --layout,\n"
+                   "--keyframe must be positive and --delta-quant not negative\n");
+        return 1;
+    }
+    while (o->zarr_codec_id < NZARR_CODECS && (zarr_codec_names[o->zarr_codec_id] == NULL
+                                               || strcmp(o->zarr_codec, zarr_codec_names[o->zarr_codec_id]) != 0))
+        o->zarr_codec_id++;
+    if ((read_mode == MODE_ZARR) != (o->zarr_dir[0] != '\0') || o->zarr_codec_id == NZARR_CODECS
+        || o->zarr_chunk < 0) {
+        if (rank == 0)
+            printf("Error: --zarr-dir is required in zarr mode and only used there, --zarr-codec must be none,\n"
+                   "shuffle-lz or lz4 (built with -DHAVE_LZ4) and --zarr-chunk not negative\n");
+        return 1;
+    }
+    if (o->sparse && read_mode != MODE_HDF5) {
+        if (rank == 0)
+            printf("Error: --sparse is only supported in hdf5 mode\n");
+        return 1;
+    }
+    o->keep_fields = o->use_transform || o->interp_n > 0 || o->use_delta;
+
+    // Serial opens have no collective operations
+    if (read_mode == MODE_SERIAL && !o->use_independent) {
+        if (rank == 0)
+            printf("Warning: serial mode reads independently, forcing use_independent=1\n");
+        o->use_independent = 1;
     }
 
     // Print configuration details from rank 0
     if (rank == 0) {
-        printf("Halo size: %d\n", halo);
-        printf("Process grid: %dx%d\n", nproc_x, nproc_y);
-        printf("Use independent access: %s\n", use_independent ? "yes" : "no");
-        printf("Number of files: %d\n", nfiles);
+        printf("Halo size: %d\n", o->halo);
+        if (o->auto_grid)
+            printf("Process grid: auto\n");
+        else
+            printf("Process grid: %dx%d\n", o->nproc_x, o->nproc_y);
+        printf("Use independent access: %s\n", o->use_independent ? "yes" : "no");
+        printf("Number of files: %d\n", o->nfiles);
+        printf("Read mode: %s\n", mode);
     }
 
-    // Calculate process coordinates in the grid
-    int px = rank % nproc_x;
-    int py = rank / nproc_x;
+    if (read_mode == MODE_FILE_PARALLEL && (o->file_groups < 1 || nprocs % o->file_groups != 0)) {
+        if (rank == 0)
+            printf("Error: number of file groups must divide nprocs\n");
+        return 1;
+    }
+
+    o->bcast_node_scope = strcmp(o->bcast_scope, "node") == 0;
+    o->bcast_use_shm = strcmp(o->bcast_method, "shm") == 0;
+    if (read_mode == MODE_BCAST && ((!o->bcast_node_scope && strcmp(o->bcast_scope, "world") != 0)
+                                    || (!o->bcast_use_shm && strcmp(o->bcast_method, "bcast") != 0)
+                                    || (o->bcast_use_shm && !o->bcast_node_scope) || o->read_size == 0)) {
+        if (rank == 0)
+            printf("Error: invalid broadcast settings (shared memory requires --bcast-scope=node)\n");
+        return 1;
+    }
+    return 0;
+}
+
+// Function to scan the first file, resolve the level window, layout, column
+// dimension and automatic grid against it, decompose the domain and set up
+// the bench state shared by the read modes
+static void setup_bench(bench_opts_t *o, bench_t *b) {
+    int rank = b->rank, nprocs = b->nprocs;
 
     // Open the first netCDF file in parallel mode
     int ncid;
-    int retval;
-    retval = nc_open_par(file_list[0], NC_NOWRITE, MPI_COMM_WORLD, MPI_INFO_NULL, &ncid);
-    if (retval != NC_NOERR) { 
-        printf("Rank %d: Error opening file %s: %s\n", rank, file_list[0], nc_strerror(retval)); 
-        safe_abort(MPI_COMM_WORLD, 1); 
-    }
-
-    // Query the number of dimensions and variables in the file
-    int nvars, ndims;
-    retval = nc_inq(ncid, &ndims, &nvars, NULL, NULL);
-    if (retval != NC_NOERR) { 
-        printf("Error querying number of dimensions & variables in file %s\n", file_list[0]); 
-        safe_abort(MPI_COMM_WORLD, 1); 
-    }
-    int lat_idx = -1;
-    int lon_idx = -1;
-
-    int dimvars = 0;
-    size_t *dimlen = (size_t *)malloc(ndims * sizeof(size_t));
-    int *is_dimvar = (int *)calloc(nvars, sizeof(int));
-    for (int varid = 0; varid < nvars; varid++) {
-        is_dimvar[varid] = 0;
+    int retval = nc_open_par(o->file_list[0], NC_NOWRITE, MPI_COMM_WORLD, MPI_INFO_NULL, &ncid);
+    if (retval != NC_NOERR) {
+        printf("Rank %d: Error opening file %s: %s\n", rank, o->file_list[0], nc_strerror(retval));
+        safe_abort(MPI_COMM_WORLD, 1);
     }
-    for (int dimid = 0; dimid < ndims; dimid++) {
-        char dim_name[NC_MAX_NAME + 1];
-        retval = nc_inq_dim(ncid, dimid, dim_name, &dimlen[dimid]);
-        if (retval != NC_NOERR) {
-            printf("Error querying dimension ID %d in file %s\n", dimid, file_list[0]);
+
+    // Discover the dimensions and variables of the first file
+    ddr_scan(ncid, o->lon_name, o->lat_name, b);
+    int nvars = b->nvars + b->dimvars;
+    int read_mode = o->read_mode;
+
+    // Variables without some dimensions of the file (2D fields next to 3D
+    // fields) are read in the modes that follow the dimensions of each
+    // variable, without the options built on the lat/lon pieces
+    int per_var_mode = (read_mode == MODE_DIRECT || read_mode == MODE_SERIAL || read_mode == MODE_BCAST
+                        || read_mode == MODE_ZARR || read_mode == MODE_ND);
+    if (!ddr_full_vars(b) && (!per_var_mode || o->auto_grid || o->use_levels || o->use_layout || o->keep_fields)) {
+        if (rank == 0)
+            printf("Error: variables without some dimensions of the file need direct, serial, bcast, zarr or nd\n"
+                   "mode with a fixed grid and without --level-dim, --layout, --transform, --interp and --delta-cache\n");
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+
+    // Restrict the reads to a window of levels
+    o->level_idx = -1;
+    if (o->use_levels) {
+        find_level_window(ncid, o->level_dim, o->level_range, o->level_by_value, &o->level_idx, &o->level0,
+                          &o->nlevel);
+        if (o->level_idx == b->lat_idx || o->level_idx == b->lon_idx) {
+            if (rank == 0)
+                printf("Error: the level dimension must not be decomposed\n");
             safe_abort(MPI_COMM_WORLD, 1);
         }
-        for (int varid = 0; varid < nvars; varid++) {
-            char var_name[NC_MAX_NAME + 1];
-            retval = nc_inq_varname(ncid, varid, var_name);
-            if (retval != NC_NOERR) {
-                printf("Error querying variable name for varid %d in file %s\n", varid, file_list[0]);
-                safe_abort(MPI_COMM_WORLD, 1);
-            }
-            if (strcmp(var_name, dim_name) == 0) {
-                dimvars++;
-                is_dimvar[varid] = 1;
-                if (strcmp(lon_name, dim_name) == 0) {
-                    lon_idx = dimid;
-                    if (rank == 0)
-                        printf("Found lon dimension at index %d\n", lon_idx);
-                }else if (strcmp(lat_name, dim_name) == 0) {
-                    lat_idx = dimid;
-                    if (rank == 0)
-                        printf("Found lat dimension at index %d\n", lat_idx);
-                }
-                break;
-            }
+        if (rank == 0)
+            report_level_window(ncid, nvars, b->is_dimvar, b->varnames, b->dimlen, o->level_idx, o->level0,
+                                o->nlevel);
+    }
+
+    // Order of the dimensions in the read buffer
+    if (o->use_layout) {
+        find_layout(ncid, o->layout, b->ndims, o->layout_perm);
+        if (rank == 0)
+            printf("Target layout: %s (%s)\n", o->layout, o->layout_method);
+    }
+
+    // Vertical dimension of the post-read transform and the interpolation
+    o->column_idx = -1;
+    if (o->keep_fields) {
+        if (nc_inq_dimid(ncid, o->column_dim, &o->column_idx) != NC_NOERR
+            || o->column_idx == b->lat_idx || o->column_idx == b->lon_idx) {
+            if (rank == 0)
+                printf("Error: column dimension %s must be a non-decomposed dimension\n", o->column_dim);
+            safe_abort(MPI_COMM_WORLD, 1);
         }
+        if (rank == 0 && o->use_transform)
+            printf("Post-read transform: %s (column dimension %s)\n", o->transform, o->column_dim);
+    }
+
+    // Choose the process grid from the layout of the data variables
+    if (o->auto_grid) {
+        grid_score_t grid = choose_grid(ncid, (nprocs - o->nservers) / o->nmembers, o->halo, b->ndims, b->dimlen,
+                                        b->lat_idx, b->lon_idx, nvars, b->is_dimvar, o->request_cost,
+                                        o->grid_trials);
+        o->nproc_x = grid.nproc_x;
+        o->nproc_y = grid.nproc_y;
         if (rank == 0) {
-            printf("  Dimension %d: name='%s', length=%zu\n", dimid, dim_name, dimlen[dimid]);
+            printf("Process grid: %dx%d (auto, score=%.0f", o->nproc_x, o->nproc_y, grid.score);
+            if (grid.trial_time >= 0.0)
+                printf(", trial_time=%.6f s", grid.trial_time);
+            printf(")\n");
         }
     }
     nc_close(ncid);
-    if (lat_idx == -1 || lon_idx == -1) {
-        printf("Error: Could not find %s/%s dimensions in file %s\n", lat_name, lon_name, file_list[0]);
-        safe_abort(MPI_COMM_WORLD, 1);
-    }
-    nvars -= dimvars;
     if (rank == 0) {
-        printf("First file contains %d dimensions and %d variables (+ %d dimension variables)\n", ndims, nvars, dimvars);
-    }
-
-    // Calculate subdomain boundaries for each process
-    int lon_size = dimlen[lon_idx], lat_size = dimlen[lat_idx];
-    int sub_lon = lon_size / nproc_x;
-    int sub_lat = lat_size / nproc_y;
-    
-    // Calculate base subdomain without halo first
-    int base_lon0 = px * sub_lon;
-    int base_lat0 = py * sub_lat;
-    int base_lon1 = px * sub_lon + sub_lon - 1;
-    int base_lat1 = py * sub_lat + sub_lat - 1;
-    
-    // Add halo, handling periodic boundaries
-    int has_periodic_halo = (halo > 0) && ( (px == 0) || (px == nproc_x - 1) );
-    int periodic_halo_lon_start = 0;
-    
-    if (halo > 0) {
-        if (px == 0) {
-            // Left boundary: don't extend left, handle periodically
-            periodic_halo_lon_start = lon_size - halo - 1;
-        } else {
-            // Not left boundary: extend left
-            base_lon0 = (base_lon0 - halo < 0) ? 0 : base_lon0 - halo;
+        printf("First file contains %d dimensions and %d variables (+ %d dimension variables)\n", b->ndims,
+               b->nvars, b->dimvars);
+    }
+
+    // Calculate subdomain boundaries for each process. Nd mode without
+    // --decomp decomposes the positional grid dimensions; the N-D
+    // decomposition has no lat/lon pieces
+    split_dim_t *split = o->split;
+    if (read_mode == MODE_ND) {
+        if (o->nsplit == 0) {
+            o->nsplit = 2;
+            snprintf(split[0].name, sizeof(split[0].name), "%s", o->lon_name);
+            split[0].nproc = o->nproc_x;
+            split[0].halo = o->halo;
+            split[0].periodic = 1;
+            snprintf(split[1].name, sizeof(split[1].name), "%s", o->lat_name);
+            split[1].nproc = o->nproc_y;
+            split[1].halo = o->halo;
+            split[1].periodic = 0;
         }
-        
-        if (px == nproc_x - 1) {
-            // Right boundary: don't extend right, handle periodically  
-            periodic_halo_lon_start = 0;
-        } else {
-            // Not right boundary: extend right
-            base_lon1 = (base_lon1 + halo >= lon_size) ? lon_size - 1 : base_lon1 + halo;
+        ddr_decompose_nd(b, split, o->nsplit);
+        if (rank == 0) {
+            printf("N-D decomposition:");
+            for (int i = 0; i < o->nsplit; i++)
+                printf(" %s:%d:%d%s", split[i].name, split[i].nproc, split[i].halo,
+                       split[i].periodic ? ":periodic" : "");
+            printf("\n");
         }
-        
-        // Add latitude halo (assuming no periodicity)
-        base_lat0 = (base_lat0 - halo < 0) ? 0 : base_lat0 - halo;
-        base_lat1 = (base_lat1 + halo >= lat_size) ? lat_size - 1 : base_lat1 + halo;
+    } else {
+        ddr_decompose(b, o->nproc_x, o->nproc_y, o->halo);
     }
+    const piece_t *pieces = b->pieces;
+    int has_periodic_halo = pieces[PIECE_LEFT_WRAP].nlon > 0 || pieces[PIECE_RIGHT_WRAP].nlon > 0;
 
     // Allocate buffer for reading data including halos
-    size_t bufsize = (sub_lat + 2*halo) * (sub_lon + 2*halo);
-    for (int d = 0; d < ndims; d++) {
-        if (d != lat_idx && d != lon_idx) {
-            bufsize *= dimlen[d];
-        }
-    }
-    float *buffer = (float*) malloc(bufsize * sizeof(float));
+    if (o->use_levels)
+        b->bufsize = b->bufsize / b->dimlen[o->level_idx] * o->nlevel;
+    b->buffer = (float*) malloc(b->bufsize * sizeof(float));
 
     if (rank == 0) {
-        printf("Processing %d files with %d ranks (%dx%d decomposition, halo=%d)\n", nfiles, nprocs, nproc_x, nproc_y, halo);
+        if (o->nsplit > 0)
+            printf("Processing %d files with %d ranks (N-D decomposition)\n", o->nfiles, nprocs);
+        else
+            printf("Processing %d files with %d ranks (%dx%d decomposition, halo=%d)\n", o->nfiles, nprocs,
+                   o->nproc_x, o->nproc_y, o->halo);
     }
-    printf("Rank %d: subdomain lat[%d:%d], lon[%d:%d]%s\n", rank, base_lat0, base_lat1, base_lon0, base_lon1, has_periodic_halo ? " with periodic halo" : "");
+    if (read_mode == MODE_IOSERVER && rank >= o->nproc_x * o->nproc_y)
+        printf("Rank %d: I/O server\n", rank);
+    else if (o->nsplit == 0)
+        printf("Rank %d: subdomain lat[%d:%d], lon[%d:%d]%s\n", rank,
+               pieces[PIECE_INTERIOR].lat0, pieces[PIECE_INTERIOR].lat0 + pieces[PIECE_INTERIOR].nlat - 1,
+               pieces[PIECE_INTERIOR].lon0, pieces[PIECE_INTERIOR].lon0 + pieces[PIECE_INTERIOR].nlon - 1,
+               has_periodic_halo ? " with periodic halo" : "");
 
     // Calculate the size of the file in bytes for timing output
-    size_t file_bytes = sizeof(float) * nvars;
-    for (int i = 0; i < ndims; i++) {
-        file_bytes *= dimlen[i];
+    size_t file_bytes = 0;
+    for (int varid = 0; varid < nvars; varid++) {
+        if (b->is_dimvar[varid]) continue;
+        size_t var_bytes = sizeof(float);
+        for (int d = 0; d < b->var_ndims[varid]; d++) {
+            int i = b->var_dimids[varid][d];
+            var_bytes *= (i == o->level_idx) ? o->nlevel : b->dimlen[i];
+        }
+        file_bytes += var_bytes;
     }
-    
-    double *file_times = (double*) malloc(nfiles * sizeof(double));
-    size_t *start = (size_t*) malloc(ndims * sizeof(size_t));
-    size_t *count = (size_t*) malloc(ndims * sizeof(size_t));
-    for (int d = 0; d < ndims; d++) {
-        start[d] = 0;
-        count[d] = dimlen[d];
+
+    // Complete the setup shared by the read modes
+    b->use_independent = o->use_independent;
+    b->nfiles = o->nfiles;
+    b->file_list = o->file_list;
+    b->file_bytes = file_bytes;
+}
+
+// Function to print one line per rank of the per-file values gathered on
+// rank 0, as "rank=R ; name=v,v,..."
+static void print_rank_values(const char *name, const double *all, int nranks, int nfiles) {
+    for (int r = 0; r < nranks; r++) {
+        printf("rank=%d ; %s=", r, name);
+        for (int f = 0; f < nfiles; f++) {
+            printf("%.6f", all[r * nfiles + f]);
+            if (f < nfiles - 1) printf(",");
+        }
+        printf("\n");
     }
+}
 
-    for (int f = 0; f < nfiles; f++) {
-        // Open each netCDF file in parallel mode
-        retval = nc_open_par(file_list[f], NC_NOWRITE, MPI_COMM_WORLD, MPI_INFO_NULL, &ncid);
-        if (retval != NC_NOERR) { 
-            printf("Rank %d: Error opening file %s: %s\n", rank, file_list[f], nc_strerror(retval)); 
-            safe_abort(MPI_COMM_WORLD, 1); 
+// Function to gather the per-file values of all ranks on rank 0; returns
+// NULL on the other ranks
+static double *gather_files(const bench_t *b, const double *values) {
+    double *all = NULL;
+    if (b->rank == 0)
+        all = (double*) malloc(b->nprocs * b->nfiles * sizeof(double));
+    MPI_Gather(values, b->nfiles, MPI_DOUBLE, all, b->nfiles, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    return all;
+}
+
+// Function to reduce per-file values to their maximum over all ranks on
+// rank 0 and return their mean and maximum over the files there
+static void reduce_files(const bench_t *b, const double *values, double *mean, double *max) {
+    double *max_values = (double*) malloc(b->nfiles * sizeof(double));
+    MPI_Reduce(values, max_values, b->nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    *mean = *max = 0.0;
+    for (int f = 0; f < b->nfiles; f++) {
+        *mean += max_values[f] / b->nfiles;
+        if (max_values[f] > *max) *max = max_values[f];
+    }
+    free(max_values);
+}
+
+// Function to report the file size and the times of each file on each rank,
+// which every mode prints first
+static void report_times(const bench_t *b, const double *file_times) {
+    double *all_times = gather_files(b, file_times);
+    if (b->rank == 0) {
+        printf("filesize=%f MB\n", (float)(b->file_bytes)/1e6);
+        print_rank_values("times", all_times, b->nprocs, b->nfiles);
+        free(all_times);
+    }
+}
+
+// Function to report the slowest open and first read over all ranks
+static void report_latency(const bench_t *b, const double *open_times, const double *first_read_times) {
+    double mean_open, max_open, mean_first, max_first;
+    reduce_files(b, open_times, &mean_open, &max_open);
+    reduce_files(b, first_read_times, &mean_first, &max_first);
+    if (b->rank == 0)
+        printf("open_time: mean=%.6f max=%.6f s ; first_read_time: mean=%.6f max=%.6f s\n",
+               mean_open, max_open, mean_first, max_first);
+}
+
+// Function to run file-parallel mode and report the aggregate bandwidth
+static void bench_file_parallel(const bench_opts_t *o, bench_t *b, double *file_times) {
+    if (b->ndims + 1 > MAX_DIMS) {
+        printf("Error: file-parallel mode supports at most %d dimensions\n", MAX_DIMS - 1);
+        safe_abort(MPI_COMM_WORLD, 1);
+    }
+    double total_time = run_file_parallel(b, o->file_groups, o->redistribute, file_times);
+    report_times(b, file_times);
+    if (b->rank == 0)
+        printf("file_groups=%d ; total_time=%.6f s ; aggregate_bandwidth=%f MB/s\n",
+               o->file_groups, total_time, (float)(b->file_bytes) * b->nfiles / 1e6 / total_time);
+}
+
+// Function to run bcast mode and report the mean time of each phase
+static void bench_bcast(const bench_opts_t *o, bench_t *b, double *file_times) {
+    double phase_times[3] = {0.0, 0.0, 0.0};
+    run_bcast(b, o->bcast_node_scope, o->bcast_use_shm, o->read_size, file_times, phase_times);
+    report_times(b, file_times);
+    if (b->rank == 0)
+        printf("bcast_scope=%s ; bcast_method=%s ; mean phase times: read=%.6f s ; distribute=%.6f s ; extract=%.6f s\n",
+               o->bcast_scope, o->bcast_method, phase_times[0], phase_times[1], phase_times[2]);
+}
+
+// Function to run hdf5 mode and report the open and first read latency and,
+// with --sparse, the bytes skipped and the speedup of each variable
+static void bench_hdf5(const bench_opts_t *o, bench_t *b, double *file_times) {
+    int nfiles = b->nfiles;
+    double *open_times = (double*) calloc(nfiles, sizeof(double));
+    double *first_read_times = (double*) calloc(nfiles, sizeof(double));
+    size_t nsparse = (size_t) nfiles * b->nvars;
+    double *sparse_times = NULL, *sparse_skipped = NULL;
+    if (o->sparse) {
+        sparse_times = (double*) calloc(2 * nsparse, sizeof(double));
+        sparse_skipped = (double*) calloc(nsparse, sizeof(double));
+    }
+    run_hdf5(b, o->coll_metadata, o->sparse, file_times, open_times, first_read_times, sparse_times, sparse_skipped);
+    report_times(b, file_times);
+    report_latency(b, open_times, first_read_times);
+
+    // Slowest sparse and plain read of each variable of each file, bytes
+    // skipped and subdomain bytes per variable over all ranks
+    if (o->sparse) {
+        double *max_sparse_times = NULL, *sum_sparse_skipped = NULL;
+        double piece_bytes = (double) pieces_size(b, b->pieces) * sizeof(float), sum_piece_bytes = 0.0;
+        max_sparse_times = (double*) malloc(2 * nsparse * sizeof(double));
+        sum_sparse_skipped = (double*) malloc(nsparse * sizeof(double));
+        MPI_Reduce(sparse_times, max_sparse_times, (int) (2 * nsparse), MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(sparse_skipped, sum_sparse_skipped, (int) nsparse, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&piece_bytes, &sum_piece_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+        for (int v = 0, varid = 0; b->rank == 0 && varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            double skipped = 0.0, mean_sparse = 0.0, mean_read = 0.0;
+            for (int f = 0; f < nfiles; f++) {
+                skipped += sum_sparse_skipped[(size_t) f * b->nvars + v] / nfiles;
+                mean_sparse += max_sparse_times[(size_t) f * b->nvars + v] / nfiles;
+                mean_read += max_sparse_times[nsparse + (size_t) f * b->nvars + v] / nfiles;
+            }
+            printf("sparse: var=%s ; skipped=%.3f MB of %.3f MB ; mean_sparse=%.6f s ; mean_read=%.6f s ;"
+                   " speedup=%.3f\n", b->varnames[varid], skipped / 1e6, sum_piece_bytes / 1e6,
+                   mean_sparse, mean_read, mean_read / mean_sparse);
+            v++;
         }
+        free(max_sparse_times);
+        free(sum_sparse_skipped);
+    }
+    free(open_times);
+    free(first_read_times);
+    free(sparse_times);
+    free(sparse_skipped);
+}
 
-        // Set parallel access mode for all data variables (skip dimension variables)
-        for (int varid = 0; varid < nvars+dimvars; varid++) {
-            if (is_dimvar[varid]) continue;
-            retval = nc_var_par_access(ncid, varid, use_independent ? NC_INDEPENDENT : NC_COLLECTIVE);
-            if (retval != NC_NOERR) { 
-                printf("Rank %d: Error setting %s access for var %d: %s\n", 
-                       rank, use_independent ? "independent" : "collective", varid, nc_strerror(retval)); 
-                safe_abort(MPI_COMM_WORLD, 1);
+// Function to run steal mode and report the idle time of each rank
+static void bench_steal(const bench_opts_t *o, bench_t *b, double *file_times) {
+    int nfiles = b->nfiles, nprocs = b->nprocs;
+    double *idle_times = (double*) calloc(nfiles, sizeof(double));
+    double *makespans = (double*) calloc(nfiles, sizeof(double));
+    run_steal(b, o->steal_tiles, o->steal, file_times, idle_times, makespans);
+    report_times(b, file_times);
+    double *all_idle = gather_files(b, idle_times);
+    if (b->rank == 0) {
+        double mean_idle = 0.0, mean_makespan = 0.0;
+        print_rank_values("idle", all_idle, nprocs, nfiles);
+        for (int i = 0; i < nprocs * nfiles; i++)
+            mean_idle += all_idle[i] / (nprocs * nfiles);
+        for (int f = 0; f < nfiles; f++)
+            mean_makespan += makespans[f] / nfiles;
+        printf("steal=%d ; tiles=%d ; mean_idle=%.6f s ; mean_makespan=%.6f s\n",
+               o->steal, o->steal_tiles, mean_idle, mean_makespan);
+        free(all_idle);
+    }
+    free(idle_times);
+    free(makespans);
+}
+
+// Function to run ioserver mode and report the stall time of each compute rank
+static void bench_ioserver(const bench_opts_t *o, bench_t *b, double *file_times) {
+    int nfiles = b->nfiles;
+    double *stall_times = (double*) calloc(nfiles, sizeof(double));
+    run_ioserver(b, o->io_servers, o->compute_time, file_times, stall_times);
+    report_times(b, file_times);
+    double *all_stalls = gather_files(b, stall_times);
+    if (b->rank == 0) {
+        int ncompute = o->nproc_x * o->nproc_y;
+        double mean_stall = 0.0, max_stall = 0.0;
+        print_rank_values("stalls", all_stalls, ncompute, nfiles);
+        for (int i = 0; i < ncompute * nfiles; i++) {
+            mean_stall += all_stalls[i] / (ncompute * nfiles);
+            if (all_stalls[i] > max_stall) max_stall = all_stalls[i];
+        }
+        printf("io_servers=%d ; compute_time=%.6f s ; mean_stall=%.6f s ; max_stall=%.6f s\n",
+               o->io_servers, o->compute_time, mean_stall, max_stall);
+        free(all_stalls);
+    }
+    free(stall_times);
+}
+
+// Function to run ensemble mode and report the effective bandwidth of all members
+static void bench_ensemble(const bench_opts_t *o, bench_t *b, double *file_times) {
+    double total_time = run_ensemble(b, o->members, o->shared_read, file_times);
+    report_times(b, file_times);
+    if (b->rank == 0)
+        printf("members=%d ; shared_read=%d ; total_time=%.6f s ; effective_bandwidth=%f MB/s\n",
+               o->members, o->shared_read, total_time,
+               (float)(b->file_bytes) * o->members * b->nfiles / 1e6 / total_time);
+}
+
+// Function to run interference mode and report the slowdown of each job
+static void bench_interference(const bench_opts_t *o, bench_t *b, double *file_times) {
+    double *solo_times = (double*) calloc(o->jobs, sizeof(double));
+    double *shared_times = (double*) calloc(o->jobs, sizeof(double));
+    run_interference(b, o->jobs, o->job_overlap, o->job_offset, file_times, solo_times, shared_times);
+    report_times(b, file_times);
+    if (b->rank == 0) {
+        double mean_slowdown = 0.0, max_slowdown = 0.0;
+        for (int j = 0; j < o->jobs; j++) {
+            double slowdown = shared_times[j] / solo_times[j];
+            printf("job=%d ; solo_time=%.6f s ; shared_time=%.6f s ; slowdown=%.3f\n",
+                   j, solo_times[j], shared_times[j], slowdown);
+            mean_slowdown += slowdown / o->jobs;
+            if (slowdown > max_slowdown) max_slowdown = slowdown;
+        }
+        printf("jobs=%d ; job_files=%s ; job_offset=%d us ; mean_slowdown=%.3f ; max_slowdown=%.3f\n",
+               o->jobs, o->job_files, o->job_offset, mean_slowdown, max_slowdown);
+    }
+    free(solo_times);
+    free(shared_times);
+}
+
+// Read throttling over all ranks or the ranks of each node, with the time
+// each rank waited for its token per file
+typedef struct {
+    throttle_t throttle;
+    MPI_Comm comm;
+    double *wait_times;
+} throttle_bench_t;
+
+static void throttle_bench_init(throttle_bench_t *t, const bench_opts_t *o, const bench_t *b) {
+    t->comm = MPI_COMM_WORLD;
+    t->wait_times = (double*) calloc(b->nfiles, sizeof(double));
+    if (o->throttle_k > 0 && o->throttle_node_scope)
+        MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL, &t->comm);
+    throttle_init(&t->throttle, o->throttle_k, o->throttle_ring ? THROTTLE_RING : THROTTLE_RMA, t->comm);
+    if (b->rank == 0 && o->throttle_k > 0)
+        printf("Throttle: at most %d concurrent readers per %s scope (%s tokens)\n",
+               o->throttle_k, o->throttle_scope, o->throttle_method);
+}
+
+static void throttle_bench_report(const throttle_bench_t *t, const bench_opts_t *o, const bench_t *b) {
+    if (o->throttle_k == 0) return;
+    int nfiles = b->nfiles, nprocs = b->nprocs;
+    double *all_waits = gather_files(b, t->wait_times);
+    if (b->rank == 0) {
+        double mean_wait = 0.0, max_wait = 0.0;
+        print_rank_values("waits", all_waits, nprocs, nfiles);
+        for (int i = 0; i < nprocs * nfiles; i++) {
+            mean_wait += all_waits[i] / (nprocs * nfiles);
+            if (all_waits[i] > max_wait) max_wait = all_waits[i];
+        }
+        printf("throttle=%d ; mean_wait=%.6f s ; max_wait=%.6f s\n", o->throttle_k, mean_wait, max_wait);
+        free(all_waits);
+    }
+}
+
+static void throttle_bench_free(throttle_bench_t *t) {
+    throttle_free(&t->throttle);
+    if (t->comm != MPI_COMM_WORLD)
+        MPI_Comm_free(&t->comm);
+    free(t->wait_times);
+}
+
+// All variables of the current and the previous file, kept for the
+// post-read steps, with the transformed copies and work space
+typedef struct {
+    float *fields, *prev_fields;
+    float *transformed, *transformed_prev;
+    float *work;
+} fields_t;
+
+static void fields_init(fields_t *fs, const bench_opts_t *o, const bench_t *b) {
+    size_t level_bytes = (size_t) b->nvars * b->bufsize * sizeof(float);
+    memset(fs, 0, sizeof(*fs));
+    if (o->keep_fields) {
+        fs->fields = (float*) malloc(level_bytes);
+        fs->transformed = (float*) malloc(level_bytes);
+        fs->work = (float*) malloc(level_bytes);
+    }
+    // Interpolation keeps the previous file as earlier time level
+    if (o->interp_n > 0) {
+        fs->prev_fields = (float*) malloc(level_bytes);
+        fs->transformed_prev = (float*) malloc(level_bytes);
+    }
+}
+
+static void fields_free(fields_t *fs) {
+    free(fs->fields);
+    free(fs->prev_fields);
+    free(fs->transformed);
+    free(fs->transformed_prev);
+    free(fs->work);
+}
+
+// Post-read transform, timed per file, and the interpolation probes before
+// and after it
+typedef struct {
+    double *transform_times;
+    double *probe_times;            // File layout and transformed, per file
+} transform_bench_t;
+
+static void transform_bench_init(transform_bench_t *t, const bench_t *b) {
+    t->transform_times = (double*) calloc(b->nfiles, sizeof(double));
+    t->probe_times = (double*) calloc(2 * b->nfiles, sizeof(double));
+}
+
+// Function to probe interpolation in the file layout, transform and probe again
+static void transform_bench_file(transform_bench_t *t, const bench_opts_t *o, const bench_t *b,
+                                 const size_t *count, fields_t *fs, int f) {
+    double sum;
+    t->probe_times[2 * f] = probe_subdomain(b, count, o->column_idx, 0, 0, fs->fields, o->probe_points, &sum);
+    double transform_start = get_time_sec();
+    transform_subdomain(b, count, o->column_idx, o->transform_cols, o->transform_inter,
+                        fs->fields, fs->transformed, fs->work);
+    t->transform_times[f] = get_time_sec() - transform_start;
+    t->probe_times[2 * f + 1] = probe_subdomain(b, count, o->column_idx, o->transform_cols, o->transform_inter,
+                                                fs->transformed, o->probe_points, &sum);
+}
+
+static void transform_bench_report(const transform_bench_t *t, const bench_opts_t *o, const bench_t *b) {
+    int nfiles = b->nfiles;
+    double mean_transform, max_transform;
+    double *max_probe_times = (double*) malloc(2 * nfiles * sizeof(double));
+    reduce_files(b, t->transform_times, &mean_transform, &max_transform);
+    MPI_Reduce(t->probe_times, max_probe_times, 2 * nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        double mean_file = 0.0, mean_out = 0.0;
+        for (int f = 0; f < nfiles; f++) {
+            mean_file += max_probe_times[2 * f] / nfiles;
+            mean_out += max_probe_times[2 * f + 1] / nfiles;
+        }
+        printf("transform=%s ; column_dim=%s ; mean_transform=%.6f s ; max_transform=%.6f s\n",
+               o->transform, o->column_dim, mean_transform, max_transform);
+        // Number of probes after which the transform has paid for itself
+        printf("interp_probe: points=%d ; file_layout=%.6f s ; transformed=%.6f s ; speedup=%.3f ; break_even=",
+               o->probe_points, mean_file, mean_out, mean_file / mean_out);
+        if (mean_out < mean_file)
+            printf("%.1f probes\n", mean_transform / (mean_file - mean_out));
+        else
+            printf("never\n");
+    }
+    free(max_probe_times);
+}
+
+static void transform_bench_free(transform_bench_t *t) {
+    free(t->transform_times);
+    free(t->probe_times);
+}
+
+// Function to return the number of OpenMP threads of the parallel regions
+static int max_threads(void) {
+    int threads = 1;
+#ifdef _OPENMP
+    threads = omp_get_max_threads();
+#endif
+    return threads;
+}
+
+// Particles interpolated between consecutive files in every layout, with the
+// Morton tiles of both time levels and the page proxies of the particles
+typedef struct {
+    float *particle_pos, *interp_out;
+    double *interp_times;           // Per file and layout
+    tiled_t tiled;
+    float *tiles_prev, *tiles;
+    double *tile_times;
+    double proxies[4];              // Pages and switches: row-major, tiled
+} interp_bench_t;
+
+static void interp_bench_init(interp_bench_t *ib, const bench_opts_t *o, const bench_t *b, const size_t *count) {
+    memset(ib, 0, sizeof(*ib));
+    ib->interp_times = (double*) calloc((size_t) NLAYOUTS * b->nfiles, sizeof(double));
+    ib->tile_times = (double*) calloc(b->nfiles, sizeof(double));
+    if (o->interp_n == 0) return;
+    ib->interp_out = (float*) malloc((size_t) o->interp_n * b->nvars * sizeof(float));
+    ib->particle_pos = (float*) malloc(3 * (size_t) o->interp_n * sizeof(float));
+    make_particles(b, count, o->column_idx, o->particle_dist, o->interp_n, ib->particle_pos);
+    if (o->tile_edge > 0) {
+        size_t block[3], block_stride[3], field_stride;
+        tiled_init(&ib->tiled, b, count, o->column_idx, o->tile_edge);
+        ib->tiles_prev = (float*) malloc((size_t) b->nvars * ib->tiled.n * sizeof(float));
+        ib->tiles = (float*) malloc((size_t) b->nvars * ib->tiled.n * sizeof(float));
+        subdomain_strides(b, count, o->column_idx, 0, 0, block, block_stride, &field_stride);
+        page_proxies(NULL, block, block_stride, ib->particle_pos, o->interp_n, &ib->proxies[0], &ib->proxies[1]);
+        page_proxies(&ib->tiled, block, NULL, ib->particle_pos, o->interp_n, &ib->proxies[2], &ib->proxies[3]);
+    }
+}
+
+// Function to interpolate the particles between the previous file (the
+// first file for itself) and this one in every layout
+static void interp_bench_file(interp_bench_t *ib, const bench_opts_t *o, const bench_t *b, const size_t *count,
+                              fields_t *fs, int f) {
+    bench_interp(b, count, o->column_idx, f > 0 ? fs->prev_fields : fs->fields, fs->fields, ib->particle_pos,
+                 o->interp_n, fs->transformed_prev, fs->transformed, fs->work, ib->interp_out,
+                 o->tile_edge > 0 ? &ib->tiled : NULL, ib->tiles_prev, ib->tiles, &ib->tile_times[f],
+                 &ib->interp_times[f * NLAYOUTS]);
+}
+
+// Function to report the interpolation rate of each float layout
+static void interp_bench_report(const interp_bench_t *ib, const bench_opts_t *o, const bench_t *b) {
+    int nfiles = b->nfiles;
+    double *max_interp_times = (double*) malloc((size_t) NLAYOUTS * nfiles * sizeof(double));
+    MPI_Reduce(ib->interp_times, max_interp_times, NLAYOUTS * nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    for (int l = 0; b->rank == 0 && l < NLAYOUTS; l++) {
+        if (l == LAYOUT_TILED && o->tile_edge == 0) continue;
+        double mean_interp = 0.0;
+        for (int f = 0; f < nfiles; f++)
+            mean_interp += max_interp_times[f * NLAYOUTS + l] / nfiles;
+        printf("interp: layout=%s ; precision=float ; particles=%s ; halo=%d ; threads=%d ; rate=%f Mparticles/s\n",
+               layout_names[l], o->particles, o->halo, max_threads(),
+               (double) o->interp_n * b->nprocs / mean_interp / 1e6);
+    }
+    free(max_interp_times);
+}
+
+// Function to report the Morton tiling time and the page proxies
+static void interp_bench_report_tiles(const interp_bench_t *ib, const bench_opts_t *o, const bench_t *b) {
+    double mean_tiling, max_tiling, sum_proxies[4];
+    reduce_files(b, ib->tile_times, &mean_tiling, &max_tiling);
+    MPI_Reduce(ib->proxies, sum_proxies, 4, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    int nprocs = b->nprocs;
+    if (b->rank == 0)
+        printf("tiled: edge=%d ; tiles=%zux%zux%zu ; mean_tiling=%.6f s ; pages_per_particle: row_major=%.3f tiled=%.3f"
+               " ; page_switches_per_particle: row_major=%.3f tiled=%.3f\n",
+               o->tile_edge, ib->tiled.ntiles[0], ib->tiled.ntiles[1], ib->tiled.ntiles[2], mean_tiling,
+               sum_proxies[0] / nprocs, sum_proxies[2] / nprocs, sum_proxies[1] / nprocs, sum_proxies[3] / nprocs);
+}
+
+static void interp_bench_free(interp_bench_t *ib, const bench_opts_t *o) {
+    free(ib->particle_pos);
+    free(ib->interp_out);
+    free(ib->interp_times);
+    if (o->tile_edge > 0)
+        tiled_free(&ib->tiled);
+    free(ib->tiles_prev);
+    free(ib->tiles);
+    free(ib->tile_times);
+}
+
+// Both time levels in each 16-bit format, with the timings (encode, decode,
+// interpolate) per file, the largest errors and overflow counts of one file
+// (fields, interpolated values), and the bytes of the float time levels and
+// of the 16-bit buffers allocated in their place
+typedef struct {
+    uint16_t *half_prev[NPRECISIONS], *half_cur[NPRECISIONS];
+    float *half_out;
+    double *half_times;
+    double half_errors[2 * NPRECISIONS];
+    double half_overflows[2 * NPRECISIONS];
+    double half_bytes[2 * NPRECISIONS];
+} half_bench_t;
+
+// The buffers are filled once with NaN, a non-zero pattern the compiler
+// cannot turn into calloc, so that the first conversion does not time page
+// faults
+static void half_bench_init(half_bench_t *hb, const bench_opts_t *o, const bench_t *b) {
+    memset(hb, 0, sizeof(*hb));
+    hb->half_times = (double*) calloc((size_t) 3 * NPRECISIONS * b->nfiles, sizeof(double));
+    for (int h = 0; h < NPRECISIONS; h++) {
+        if (!o->use_half[h]) continue;
+        size_t level_bytes = (size_t) b->nvars * b->bufsize * sizeof(uint16_t);
+        hb->half_prev[h] = (uint16_t*) malloc(level_bytes);
+        hb->half_cur[h] = (uint16_t*) malloc(level_bytes);
+        memset(hb->half_prev[h], 0xff, level_bytes);
+        memset(hb->half_cur[h], 0xff, level_bytes);
+        hb->half_bytes[2 * h] = 2.0 * b->nvars * b->bufsize * sizeof(float);  // fields and prev_fields
+        hb->half_bytes[2 * h + 1] = 2.0 * level_bytes;                         // half_cur and half_prev
+        if (hb->half_out == NULL)
+            hb->half_out = (float*) malloc((size_t) o->interp_n * b->nvars * sizeof(float));
+    }
+}
+
+// Function to keep this file in each 16-bit format and interpolate from it,
+// against the float results of the last layout
+static void half_bench_file(half_bench_t *hb, const bench_opts_t *o, const bench_t *b, const size_t *count,
+                            const interp_bench_t *ib, fields_t *fs, int f) {
+    for (int h = 0; h < NPRECISIONS; h++) {
+        if (!o->use_half[h]) continue;
+        double errors[2];
+        size_t overflows[2];
+        bench_half(h, b, count, o->column_idx, fs->fields, f > 0 ? hb->half_prev[h] : hb->half_cur[h],
+                   hb->half_cur[h], ib->particle_pos, o->interp_n, ib->interp_out, hb->half_out, fs->work,
+                   &hb->half_times[(f * NPRECISIONS + h) * 3], errors, overflows);
+        for (int e = 0; e < 2; e++) {
+            if (errors[e] > hb->half_errors[2 * h + e]) hb->half_errors[2 * h + e] = errors[e];
+            if ((double) overflows[e] > hb->half_overflows[2 * h + e])
+                hb->half_overflows[2 * h + e] = (double) overflows[e];
+        }
+        uint16_t *tmp = hb->half_prev[h];
+        hb->half_prev[h] = hb->half_cur[h];
+        hb->half_cur[h] = tmp;
+    }
+}
+
+// Function to report the interpolation rate from each 16-bit format, then
+// its memory, conversion times, errors and overflows
+static void half_bench_report(const half_bench_t *hb, const bench_opts_t *o, const bench_t *b) {
+    int nfiles = b->nfiles;
+    double *max_half_times = (double*) malloc((size_t) 3 * NPRECISIONS * nfiles * sizeof(double));
+    double max_half_errors[2 * NPRECISIONS], sum_half_overflows[2 * NPRECISIONS], sum_half_bytes[2 * NPRECISIONS];
+    MPI_Reduce(hb->half_times, max_half_times, 3 * NPRECISIONS * nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(hb->half_errors, max_half_errors, 2 * NPRECISIONS, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(hb->half_overflows, sum_half_overflows, 2 * NPRECISIONS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(hb->half_bytes, sum_half_bytes, 2 * NPRECISIONS, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        for (int h = 0; h < NPRECISIONS; h++) {
+            if (!o->use_half[h]) continue;
+            double mean_interp = 0.0;
+            for (int f = 0; f < nfiles; f++)
+                mean_interp += max_half_times[(f * NPRECISIONS + h) * 3 + 2] / nfiles;
+            printf("interp: layout=file ; precision=%s ; particles=%s ; halo=%d ; threads=%d ; rate=%f Mparticles/s\n",
+                   precision_names[h], o->particles, o->halo, max_threads(),
+                   (double) o->interp_n * b->nprocs / mean_interp / 1e6);
+        }
+        for (int h = 0; h < NPRECISIONS; h++) {
+            if (!o->use_half[h]) continue;
+            double mean_encode = 0.0, mean_decode = 0.0;
+            for (int f = 0; f < nfiles; f++) {
+                mean_encode += max_half_times[(f * NPRECISIONS + h) * 3] / nfiles;
+                mean_decode += max_half_times[(f * NPRECISIONS + h) * 3 + 1] / nfiles;
             }
+            // Both time levels of all variables over all ranks
+            printf("half: format=%s ; memory: float=%.3f MB half=%.3f MB ; mean_encode=%.6f s ;"
+                   " mean_decode=%.6f s ; field_error=%.3e ; interp_error=%.3e ; overflows: fields=%.0f interp=%.0f\n",
+                   precision_names[h], sum_half_bytes[2 * h] / 1e6, sum_half_bytes[2 * h + 1] / 1e6,
+                   mean_encode, mean_decode,
+                   max_half_errors[2 * h], max_half_errors[2 * h + 1], sum_half_overflows[2 * h],
+                   sum_half_overflows[2 * h + 1]);
         }
+    }
+    free(max_half_times);
+}
+
+static void half_bench_free(half_bench_t *hb) {
+    for (int h = 0; h < NPRECISIONS; h++) {
+        free(hb->half_prev[h]);
+        free(hb->half_cur[h]);
+    }
+    free(hb->half_out);
+    free(hb->half_times);
+}
+
+// Compressed store of the tiles of each file, with the seconds to compress,
+// to decompress one tile, and to interpolate from the plain tiles and
+// through the store for each file, and the totals of stored bytes, LRU hits
+// and misses
+typedef struct {
+    store_t store;
+    double *store_times;
+    double store_counts[3];
+} store_bench_t;
+
+static void store_bench_init(store_bench_t *sb, const bench_opts_t *o, const bench_t *b, interp_bench_t *ib) {
+    memset(sb->store_counts, 0, sizeof(sb->store_counts));
+    sb->store_times = (double*) calloc((size_t) 4 * b->nfiles, sizeof(double));
+    if (o->use_store)
+        store_init(&sb->store, &ib->tiled, b->nvars, o->codec, o->store_cache);
+}
+
+// Function to compress the tiles of this file and interpolate at the
+// particles from the plain tiles and through the store
+static void store_bench_file(store_bench_t *sb, const bench_opts_t *o, const interp_bench_t *ib, int f) {
+    sb->store_times[4 * f] = store_put(&sb->store, ib->tiles);
+    sb->store_times[4 * f + 1] = store_latency(&sb->store);
+    sb->store_times[4 * f + 2] = store_interp(&sb->store, ib->tiles, ib->particle_pos, o->interp_n, ib->interp_out);
+    sb->store_times[4 * f + 3] = store_interp(&sb->store, NULL, ib->particle_pos, o->interp_n, ib->interp_out);
+    sb->store_counts[0] += (double) sb->store.stored_bytes;
+    sb->store_counts[1] += (double) sb->store.hits;
+    sb->store_counts[2] += (double) sb->store.misses;
+}
+
+static void store_bench_report(const store_bench_t *sb, const bench_opts_t *o, const bench_t *b,
+                               const interp_bench_t *ib) {
+    int nfiles = b->nfiles, nprocs = b->nprocs;
+    double *max_store_times = (double*) malloc((size_t) 4 * nfiles * sizeof(double));
+    double sum_store_counts[3];
+    MPI_Reduce(sb->store_times, max_store_times, 4 * nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(sb->store_counts, sum_store_counts, 3, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        double mean_store[4] = {0.0, 0.0, 0.0, 0.0};
+        for (int f = 0; f < nfiles; f++)
+            for (int k = 0; k < 4; k++)
+                mean_store[k] += max_store_times[4 * f + k] / nfiles;
+        // Uncompressed tiles of one time level over all ranks
+        double raw_mb = (double) b->nvars * ib->tiled.n * sizeof(float) * nprocs / 1e6;
+        double stored_mb = sum_store_counts[0] / nfiles / 1e6;
+        printf("store: codec=%s ; cache=%d tiles ; ratio=%.3f ; stored=%.3f MB of %.3f MB ; mean_compress=%.6f s ;"
+               " tile_latency=%.3f us ; hit_rate=%.3f ; access: plain=%f store=%f Mparticles/s\n",
+               codec_names[o->codec], o->store_cache, raw_mb / stored_mb, stored_mb, raw_mb, mean_store[0],
+               mean_store[1] * 1e6, sum_store_counts[1] / (sum_store_counts[1] + sum_store_counts[2]),
+               (double) o->interp_n * nprocs / mean_store[2] / 1e6, (double) o->interp_n * nprocs / mean_store[3] / 1e6);
+    }
+    free(max_store_times);
+}
+
+static void store_bench_free(store_bench_t *sb, const bench_opts_t *o) {
+    if (o->use_store)
+        store_free(&sb->store);
+    free(sb->store_times);
+}
+
+// Rank-local delta cache written while reading the netCDF files, with the
+// bytes, conversion time and largest error of each step
+typedef struct {
+    delta_cache_t delta;
+    char delta_path[4096];
+    double *delta_bytes;
+    double *delta_times;            // Convert, read, reconstruct
+    double delta_error, subdomain_bytes;
+} delta_bench_t;
+
+static void delta_bench_init(delta_bench_t *db, const bench_opts_t *o, const bench_t *b, const size_t *count) {
+    db->delta_bytes = (double*) calloc(b->nfiles, sizeof(double));
+    db->delta_times = (double*) calloc((size_t) 3 * b->nfiles, sizeof(double));
+    db->delta_error = db->subdomain_bytes = 0.0;
+    if (o->use_delta) {
+        size_t counts[NPIECES][MAX_DIMS], sizes[NPIECES];
+        snprintf(db->delta_path, sizeof(db->delta_path), "%s/delta_%d.bin", o->delta_dir, b->rank);
+        delta_open(&db->delta, db->delta_path, 1, b->nvars, piece_counts(b, count, counts, sizes), b->bufsize,
+                   o->keyframe, o->delta_quant);
+        db->subdomain_bytes = (double) b->nvars * db->delta.n * sizeof(float);
+    }
+}
+
+// Function to append this file to the delta cache
+static void delta_bench_file(delta_bench_t *db, const fields_t *fs, int f) {
+    double error, convert_start = get_time_sec();
+    db->delta_bytes[f] = (double) delta_write(&db->delta, fs->fields, &error);
+    db->delta_times[3 * f] = get_time_sec() - convert_start;
+    if (error > db->delta_error) db->delta_error = error;
+}
+
+// Function to read the delta cache back, reconstructing every step
+static void delta_bench_read(delta_bench_t *db, const bench_opts_t *o, const bench_t *b, fields_t *fs) {
+    delta_close(&db->delta);
+    MPI_Barrier(MPI_COMM_WORLD);
+    delta_open(&db->delta, db->delta_path, 0, db->delta.nvars, db->delta.n, b->bufsize, o->keyframe,
+               o->delta_quant);
+    for (int f = 0; f < b->nfiles; f++)
+        delta_read(&db->delta, fs->fields, &db->delta_times[3 * f + 1]);
+    delta_close(&db->delta);
+}
+
+// Function to report the bytes per step of the keyframes and the deltas
+// against the subdomains read from the netCDF files
+static void delta_bench_report(const delta_bench_t *db, const bench_opts_t *o, const bench_t *b,
+                               const double *file_times) {
+    int nfiles = b->nfiles;
+    double *sum_delta_bytes = (double*) malloc(nfiles * sizeof(double));
+    double *max_delta_times = (double*) malloc((size_t) 3 * nfiles * sizeof(double));
+    double max_delta_error, sum_subdomain_bytes, mean_netcdf, max_netcdf;
+    MPI_Reduce(db->delta_bytes, sum_delta_bytes, nfiles, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(db->delta_times, max_delta_times, 3 * nfiles, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    reduce_files(b, file_times, &mean_netcdf, &max_netcdf);
+    MPI_Reduce(&db->delta_error, &max_delta_error, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&db->subdomain_bytes, &sum_subdomain_bytes, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        double key_mb = 0.0, diff_mb = 0.0, mean_times[3] = {0.0, 0.0, 0.0};
+        int nkey = 0;
+        for (int f = 0; f < nfiles; f++) {
+            if (f % o->keyframe == 0) {
+                key_mb += sum_delta_bytes[f] / 1e6;
+                nkey++;
+            } else {
+                diff_mb += sum_delta_bytes[f] / 1e6;
+            }
+            for (int k = 0; k < 3; k++)
+                mean_times[k] += max_delta_times[3 * f + k] / nfiles;
+        }
+        printf("delta: keyframe=%d ; quant=%g ; bytes_per_step: netcdf=%.3f MB cache=%.3f MB keyframe=%.3f MB"
+               " delta=%.3f MB ; mean_convert=%.6f s ; mean_read=%.6f s ; mean_reconstruct=%.6f s ;"
+               " mean_netcdf=%.6f s ; max_error=%.3e\n",
+               o->keyframe, o->delta_quant, sum_subdomain_bytes / 1e6, (key_mb + diff_mb) / nfiles, key_mb / nkey,
+               nfiles > nkey ? diff_mb / (nfiles - nkey) : 0.0, mean_times[0], mean_times[1], mean_times[2],
+               mean_netcdf, max_delta_error);
+    }
+    free(sum_delta_bytes);
+    free(max_delta_times);
+}
+
+static void delta_bench_free(delta_bench_t *db) {
+    free(db->delta_bytes);
+    free(db->delta_times);
+}
+
+// Conversion of the files into chunk stores and the chunks fetched by the
+// zarr engine, compared with reads of the same subdomains from the netCDF
+// files
+typedef struct {
+    double convert_time;
+    double bytes[2];                // Raw and stored bytes of the conversion
+    double counts[2];               // Chunks and chunk bytes fetched
+    double *netcdf_times;
+} zarr_bench_t;
+
+// Function to convert the files into chunk stores, the chunks dealt to all
+// ranks, if requested
+static void zarr_bench_init(zarr_bench_t *zb, const bench_opts_t *o, bench_t *b) {
+    memset(zb, 0, sizeof(*zb));
+    zb->netcdf_times = (double*) calloc(b->nfiles, sizeof(double));
+    if (!o->zarr_convert_files) return;
+    for (int f = 0; f < b->nfiles; f++) {
+        char store[4096];
+        size_t bytes[2];
+        zarr_store_path(o->zarr_dir, b->file_list[f], store, sizeof(store));
+        zb->convert_time += zarr_convert(b, b->file_list[f], store, o->zarr_codec_id, o->zarr_chunk,
+                                         MPI_COMM_WORLD, bytes);
+        zb->bytes[0] += (double) bytes[0];
+        zb->bytes[1] += (double) bytes[1];
+    }
+}
+
+static void zarr_bench_report(const zarr_bench_t *zb, const bench_opts_t *o, const bench_t *b,
+                              const double *file_times) {
+    int nfiles = b->nfiles;
+    double max_convert_time, sum_bytes[2], sum_counts[2], mean_zarr, max_zarr, mean_netcdf, max_netcdf;
+    reduce_files(b, zb->netcdf_times, &mean_netcdf, &max_netcdf);
+    reduce_files(b, file_times, &mean_zarr, &max_zarr);
+    MPI_Reduce(&zb->convert_time, &max_convert_time, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(zb->bytes, sum_bytes, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(zb->counts, sum_counts, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    if (b->rank == 0) {
+        if (o->zarr_convert_files)
+            printf("zarr_convert: codec=%s ; chunk_edge=%d ; total_time=%.6f s ; stored=%.3f MB of %.3f MB ;"
+                   " ratio=%.3f\n", o->zarr_codec, o->zarr_chunk, max_convert_time, sum_bytes[1] / 1e6,
+                   sum_bytes[0] / 1e6, sum_bytes[0] / sum_bytes[1]);
+        printf("zarr: threads=%d ; chunks_per_file=%.1f ; fetched_per_file=%.3f MB ; mean_zarr=%.6f s ;"
+               " mean_netcdf=%.6f s ; speedup=%.3f\n", max_threads(), sum_counts[0] / nfiles,
+               sum_counts[1] / nfiles / 1e6, mean_zarr, mean_netcdf, mean_netcdf / mean_zarr);
+    }
+}
+
+// Function to run direct, two-phase, serial or zarr mode through the engine
+// of the same name, with the throttle and the post-read steps of the
+// options, and report the timings of each step
+static void bench_engines(const bench_opts_t *o, bench_t *b, double *file_times) {
+    int nfiles = b->nfiles;
+    throttle_bench_t tb;
+    throttle_bench_init(&tb, o, b);
+
+    ddr_options_t opt;
+    ddr_options_init(&opt);
+    opt.readahead = o->readahead;
+    if (o->use_layout) {
+        opt.layout = o->layout_perm;
+        opt.mapped = o->layout_mapped;
+    }
+    opt.naggr = o->naggr;
+    opt.aggr_placement = o->aggr_placement;
+    opt.cb_buffer = o->cb_buffer;
+    opt.stripe_size = o->stripe_size;
+    opt.zarr_dir = o->zarr_dir;
+    opt.verbose = 1;
+    ddr_reader_t reader;
+    ddr_reader_init(&reader, ddr_find_engine(mode_names[o->read_mode]), b, MPI_COMM_WORLD, &opt);
+    if (o->use_levels) {
+        reader.start[o->level_idx] = o->level0;
+        reader.count[o->level_idx] = o->nlevel;
+    }
+    const size_t *count = reader.count;
+
+    zarr_bench_t zb;
+    if (o->read_mode == MODE_ZARR)
+        zarr_bench_init(&zb, o, b);
+
+    // With a post-read transform or interpolation all variables of a file are
+    // kept; both run after the read and are timed separately
+    fields_t fs;
+    transform_bench_t xb;
+    interp_bench_t ib;
+    half_bench_t hb;
+    store_bench_t sb;
+    delta_bench_t db;
+    fields_init(&fs, o, b);
+    transform_bench_init(&xb, b);
+    interp_bench_init(&ib, o, b, count);
+    half_bench_init(&hb, o, b);
+    store_bench_init(&sb, o, b, &ib);
+    delta_bench_init(&db, o, b, count);
+    if (o->interp_n > 0) {
+        // Start the OpenMP threads before the first timed interpolation
+#ifdef _OPENMP
+#pragma omp parallel
+        {
+        }
+#endif
+    }
+
+    double *open_times = (double*) calloc(nfiles, sizeof(double));
+    double *first_read_times = (double*) calloc(nfiles, sizeof(double));
+    double *transpose_times = (double*) calloc(nfiles, sizeof(double));
+    for (int f = 0; f < nfiles; f++) {
+        // Open each netCDF file with the engine. Two-phase mode coordinates
+        // through MPI, so only the aggregators access the file independently
+        double open_start = get_time_sec();
+        ddr_open(&reader, b->file_list[f]);
+        open_times[f] = get_time_sec() - open_start;
 
         double file_start = get_time_sec();
-        for (int varid = 0; varid < nvars+dimvars; varid++) {
-            if (is_dimvar[varid]) continue;
-            // Read the subdomain for this variable
-            start[lat_idx] = base_lat0;
-            start[lon_idx] = base_lon0;
-            count[lat_idx] = base_lat1-base_lat0+1;
-            count[lon_idx] = base_lon1-base_lon0+1;
-            retval = nc_get_vara_float(ncid, varid, start, count, buffer);
+        int first = 1;
+        tb.wait_times[f] = throttle_acquire(&tb.throttle, f);
+        int ivar = 0;
+        for (int varid = 0; varid < b->nvars + b->dimvars; varid++) {
+            if (b->is_dimvar[varid]) continue;
+            // Read the subdomain including its periodic halo for this variable
+            float *dst = o->keep_fields ? fs.fields + (size_t) ivar++ * b->bufsize : b->buffer;
+            int retval = ddr_read(&reader, varid, dst);
             if (retval != NC_NOERR) {
-                printf("Rank %d: Error reading subdomain for var %d: %s\n", rank, varid, nc_strerror(retval));
+                printf("Rank %d: Error reading subdomain for var %d: %s\n", b->rank, varid, nc_strerror(retval));
                 safe_abort(MPI_COMM_WORLD, 1);
             }
-            buffer[0] *= 3.4;
-            // Read periodic halo if applicable
-            if (halo > 0 && has_periodic_halo) {
-                start[lon_idx] = periodic_halo_lon_start;
-                count[lon_idx] = halo;
-                retval = nc_get_vara_float(ncid, varid, start, count, buffer);
-                if (retval != NC_NOERR) {
-                    printf("Rank %d: Error reading periodic halo for var %d: %s\n", rank, varid, nc_strerror(retval));
-                    safe_abort(MPI_COMM_WORLD, 1);
-                }
-                buffer[0] *= 3.4;
+            dst[0] *= 3.4;
+            if (first) {
+                first_read_times[f] = get_time_sec() - file_start;
+                first = 0;
             }
         }
-        nc_close(ncid);
+        throttle_release(&tb.throttle, f);
+        transpose_times[f] = reader.stats.transpose_time;
+        if (o->read_mode == MODE_ZARR) {
+            zb.counts[0] += (double) reader.stats.chunks;
+            zb.counts[1] += (double) reader.stats.chunk_bytes;
+        }
+        ddr_close(&reader);
         MPI_Barrier(MPI_COMM_WORLD);
-        double file_end = get_time_sec();
-        file_times[f] = file_end - file_start;
+        file_times[f] = get_time_sec() - file_start;
+
+        // Post-read steps on all variables of this file
+        if (o->use_delta)
+            delta_bench_file(&db, &fs, f);
+        if (o->use_transform)
+            transform_bench_file(&xb, o, b, count, &fs, f);
+        if (o->interp_n > 0) {
+            interp_bench_file(&ib, o, b, count, &fs, f);
+            half_bench_file(&hb, o, b, count, &ib, &fs, f);
+            if (o->use_store)
+                store_bench_file(&sb, o, &ib, f);
+            float *tmp = fs.prev_fields;
+            fs.prev_fields = fs.fields;
+            fs.fields = tmp;
+        }
     }
+    if (o->use_delta)
+        delta_bench_read(&db, o, b, &fs);
 
-    // Gather timing results from all ranks
-    double *all_times = NULL;
-    if (rank == 0) {
-        all_times = (double*) malloc(nprocs * nfiles * sizeof(double));
+    // Read the same subdomains from the netCDF files with nc_get_vara_float
+    // after serial opens, for comparison with the chunk stores
+    if (o->read_mode == MODE_ZARR)
+        time_netcdf_reads(b, zb.netcdf_times);
+
+    // Report each step, reduced over all ranks
+    report_times(b, file_times);
+    report_latency(b, open_times, first_read_times);
+    if (o->use_layout) {
+        double mean_transpose, max_transpose;
+        reduce_files(b, transpose_times, &mean_transpose, &max_transpose);
+        if (b->rank == 0)
+            printf("layout=%s ; layout_method=%s ; mean_transpose=%.6f s ; max_transpose=%.6f s\n",
+                   o->layout, o->layout_method, mean_transpose, max_transpose);
     }
-    
-    // Gather all file times to rank 0
-    MPI_Gather(file_times, nfiles, MPI_DOUBLE, all_times, nfiles, MPI_DOUBLE, 0, MPI_COMM_WORLD);
-    
-    // Print results from rank 0
-    if (rank == 0) {
-        printf("filesize=%f MB\n", (float)(file_bytes)/1e6);
-        for (int r = 0; r < nprocs; r++) {
-            printf("rank=%d ; times=", r);
-            for (int f = 0; f < nfiles; f++) {
-                printf("%.6f", all_times[r * nfiles + f]);
-                if (f < nfiles - 1) printf(",");
-            }
-            printf("\n");
-        }
-        free(all_times);
+    if (o->use_transform)
+        transform_bench_report(&xb, o, b);
+    if (o->interp_n > 0) {
+        interp_bench_report(&ib, o, b);
+        half_bench_report(&hb, o, b);
+    }
+    if (o->use_store)
+        store_bench_report(&sb, o, b, &ib);
+    if (o->use_delta)
+        delta_bench_report(&db, o, b, file_times);
+    if (o->read_mode == MODE_ZARR) {
+        zarr_bench_report(&zb, o, b, file_times);
+        free(zb.netcdf_times);
     }
+    if (o->tile_edge > 0)
+        interp_bench_report_tiles(&ib, o, b);
+    throttle_bench_report(&tb, o, b);
+
+    free(open_times);
+    free(first_read_times);
+    free(transpose_times);
+    fields_free(&fs);
+    transform_bench_free(&xb);
+    interp_bench_free(&ib, o);
+    half_bench_free(&hb);
+    store_bench_free(&sb, o);
+    delta_bench_free(&db);
+    ddr_reader_free(&reader);
+    throttle_bench_free(&tb);
+}
 
-    free(start);
-    free(count);
-    free(dimlen);
-    free(is_dimvar);
+int main(int argc, char **argv) {
+    // Initialize MPI and get rank and size
+    int rank, nprocs;
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+    // Parse and check the options
+    bench_opts_t opts;
+    if (parse_options(&argc, argv, rank, nprocs, &opts) != 0) {
+        MPI_Finalize();
+        return 1;
+    }
+
+    // Set up the decomposition from the first file
+    bench_t bench;
+    memset(&bench, 0, sizeof(bench));
+    bench.rank = rank;
+    bench.nprocs = nprocs;
+    setup_bench(&opts, &bench);
+
+    // Run the read mode, which reports its timings from rank 0
+    double *file_times = (double*) malloc(opts.nfiles * sizeof(double));
+    if (opts.read_mode == MODE_FILE_PARALLEL)
+        bench_file_parallel(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_BCAST)
+        bench_bcast(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_HDF5)
+        bench_hdf5(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_METADATA) {
+        run_metadata(&bench, opts.meta_comm_size, opts.meta_repeat, opts.meta_stagger, file_times);
+        report_times(&bench, file_times);
+    } else if (opts.read_mode == MODE_STEAL)
+        bench_steal(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_IOSERVER)
+        bench_ioserver(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_ENSEMBLE)
+        bench_ensemble(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_INTERFERENCE)
+        bench_interference(&opts, &bench, file_times);
+    else if (opts.read_mode == MODE_ND) {
+        run_nd(&bench, file_times);
+        report_times(&bench, file_times);
+    } else
+        bench_engines(&opts, &bench, file_times);
+
+    ddr_free(&bench);
+    free(bench.buffer);
     free(file_times);
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -24,8 +24,54 @@ def parse_log_file(filepath):
         'halo_size': None,
         'process_grid': None,
         'independent_access': None,
+        'read_mode': None,
         'num_files': None,
         'filesize': None,
+        'open_time': None,
+        'first_read_time': None,
+        'opens_per_sec': None,
+        'open_latency_p99': None,
+        'throttle': None,
+        'mean_wait': None,
+        'steal': None,
+        'mean_idle': None,
+        'mean_makespan': None,
+        'io_servers': None,
+        'mean_stall': None,
+        'members': None,
+        'shared_read': None,
+        'effective_bandwidth': None,
+        'jobs': None,
+        'job_files': None,
+        'mean_slowdown': None,
+        'max_slowdown': None,
+        'levels': None,
+        'level_saved_mb': None,
+        'layout': None,
+        'layout_method': None,
+        'mean_transpose': None,
+        'transform': None,
+        'mean_transform': None,
+        'interp_speedup': None,
+        'break_even': None,
+        'particles': None,
+        'interp_rates': {},  # layout -> Mparticles/s
+        'tile_edge': None,
+        'mean_tiling': None,
+        'pages_row_major': None,
+        'pages_tiled': None,
+        'half': {},  # format -> memory, conversion times and errors
+        'store_codec': None,
+        'store_ratio': None,
+        'tile_latency': None,  # us
+        'store_hit_rate': None,
+        'store_rates': None,  # (plain, store) Mparticles/s
+        'delta': None,  # bytes per step, read and reconstruction cost and error of the delta cache
+        'zarr': None,  # conversion, chunks fetched and read times of the chunk stores against netCDF
+        'sparse': {},  # variable -> skipped MB and sparse against plain HDF5 read times
+        'grid_auto': False,
+        'file_groups': None,
+        'aggregate_bandwidth': None,
         'timings': {},  # rank -> list of times
         'start_time': None
     }
@@ -42,12 +88,157 @@ def parse_log_file(filepath):
     grid_match = re.search(r'Process grid: (\d+)x(\d+)', content)
     if grid_match:
         data['process_grid'] = (int(grid_match.group(1)), int(grid_match.group(2)))
+        data['grid_auto'] = 'Process grid: auto' in content
     
     # Extract independent access
     access_match = re.search(r'Use independent access: (yes|no)', content)
     if access_match:
         data['independent_access'] = access_match.group(1) == 'yes'
     
+    # Extract read mode (logs from older versions only have direct reads)
+    mode_match = re.search(r'Read mode: (\S+)', content)
+    data['read_mode'] = mode_match.group(1) if mode_match else 'direct'
+    
+    # Extract open and first-read latency (mean over files of the slowest rank)
+    latency_match = re.search(r'open_time: mean=([\d\.]+) max=[\d\.]+ s ; first_read_time: mean=([\d\.]+) max=[\d\.]+ s', content)
+    if latency_match:
+        data['open_time'] = float(latency_match.group(1))
+        data['first_read_time'] = float(latency_match.group(2))
+    
+    # Extract metadata-only results (opens/s and tail latency of the open cycle)
+    metadata_match = re.search(r'opens_per_sec=([\d\.]+)', content)
+    if metadata_match:
+        data['opens_per_sec'] = float(metadata_match.group(1))
+        p99_match = re.search(r'metadata latency: p50=[\d\.]+ p90=[\d\.]+ p99=([\d\.]+)', content)
+        if p99_match:
+            data['open_latency_p99'] = float(p99_match.group(1))
+    
+    # Extract read throttling (concurrent readers K and mean token wait)
+    throttle_match = re.search(r'throttle=(\d+) ; mean_wait=([\d\.]+) s', content)
+    if throttle_match:
+        data['throttle'] = int(throttle_match.group(1))
+        data['mean_wait'] = float(throttle_match.group(2))
+    
+    # Extract work-stealing results (mean idle time per rank and makespan per file)
+    steal_match = re.search(r'steal=(\d) ; tiles=\d+ ; mean_idle=([\d\.]+) s ; mean_makespan=([\d\.]+) s', content)
+    if steal_match:
+        data['steal'] = steal_match.group(1) == '1'
+        data['mean_idle'] = float(steal_match.group(2))
+        data['mean_makespan'] = float(steal_match.group(3))
+
+    # Extract I/O server results (mean stall time of the compute ranks)
+    ioserver_match = re.search(r'io_servers=(\d+) ; compute_time=[\d\.]+ s ; mean_stall=([\d\.]+) s', content)
+    if ioserver_match:
+        data['io_servers'] = int(ioserver_match.group(1))
+        data['mean_stall'] = float(ioserver_match.group(2))
+
+    # Extract ensemble results (bandwidth delivered to all members)
+    ensemble_match = re.search(r'members=(\d+) ; shared_read=(\d) ; total_time=[\d\.]+ s ; effective_bandwidth=([\d\.]+) MB/s', content)
+    if ensemble_match:
+        data['members'] = int(ensemble_match.group(1))
+        data['shared_read'] = ensemble_match.group(2) == '1'
+        data['effective_bandwidth'] = float(ensemble_match.group(3))
+
+    # Extract interference results (slowdown of concurrent jobs against their solo runs)
+    interference_match = re.search(r'jobs=(\d+) ; job_files=(\w+) ; job_offset=\d+ us ; mean_slowdown=([\d\.]+) ; max_slowdown=([\d\.]+)', content)
+    if interference_match:
+        data['jobs'] = int(interference_match.group(1))
+        data['job_files'] = interference_match.group(2)
+        data['mean_slowdown'] = float(interference_match.group(3))
+        data['max_slowdown'] = float(interference_match.group(4))
+
+    # Extract the level window (levels read and bytes saved over all variables)
+    level_match = re.search(r'level_window: levels=(\d+:\d+) \(\d+ of \d+\) ; requested=[\d\.]+ MB ; touched=[\d\.]+ MB ; saved=([\d\.]+) MB', content)
+    if level_match:
+        data['levels'] = level_match.group(1)
+        data['level_saved_mb'] = float(level_match.group(2))
+    
+    # Extract the target layout (mapped reads or read-then-transpose with its time)
+    layout_match = re.search(r'layout=(\S+) ; layout_method=(\w+) ; mean_transpose=([\d\.]+) s', content)
+    if layout_match:
+        data['layout'] = layout_match.group(1)
+        data['layout_method'] = layout_match.group(2)
+        data['mean_transpose'] = float(layout_match.group(3))
+    
+    # Extract the post-read transform and the interpolation speed-up it buys
+    transform_match = re.search(r'transform=(\w+) ; column_dim=\S+ ; mean_transform=([\d\.]+) s', content)
+    if transform_match:
+        data['transform'] = transform_match.group(1)
+        data['mean_transform'] = float(transform_match.group(2))
+    probe_match = re.search(r'interp_probe: points=\d+ ; file_layout=[\d\.]+ s ; transformed=[\d\.]+ s ; speedup=([\d\.]+) ; break_even=([\d\.]+|never)', content)
+    if probe_match:
+        data['interp_speedup'] = float(probe_match.group(1))
+        data['break_even'] = probe_match.group(2)
+    
+    # Extract the particle interpolation rates for each layout
+    for layout, precision, particles, rate in re.findall(r'interp: layout=(\w+) ; precision=(\w+) ; particles=(\w+) ; halo=\d+ ; threads=\d+ ; rate=([\d\.]+) Mparticles/s', content):
+        data['particles'] = particles
+        data['interp_rates'][f"{layout}/{precision}"] = float(rate)
+    
+    # Extract the Morton tiling cost and the TLB-miss proxies against row-major
+    tiled_match = re.search(r'tiled: edge=(\d+) ; tiles=\S+ ; mean_tiling=([\d\.]+) s ; pages_per_particle: row_major=([\d\.]+) tiled=([\d\.]+)', content)
+    if tiled_match:
+        data['tile_edge'] = int(tiled_match.group(1))
+        data['mean_tiling'] = float(tiled_match.group(2))
+        data['pages_row_major'] = float(tiled_match.group(3))
+        data['pages_tiled'] = float(tiled_match.group(4))
+    
+    # Extract the memory, conversion cost and accuracy of the 16-bit fields
+    for fmt, level_mb, half_mb, encode, decode, field_error, interp_error, overflows in re.findall(
+            r'half: format=(\w+) ; level_size: float=([\d\.]+) MB half=([\d\.]+) MB ; saved=[\d\.]+ MB ; mean_encode=([\d\.]+) s ;'
+            r' mean_decode=([\d\.]+) s ; field_error=(\S+) ; interp_error=(\S+) ; overflows: fields=(\d+)', content):
+        data['half'][fmt] = {'level_mb': float(level_mb), 'half_mb': float(half_mb), 'encode': float(encode),
+                             'decode': float(decode), 'field_error': float(field_error),
+                             'interp_error': float(interp_error), 'overflows': int(overflows)}
+    
+    # Extract the compression ratio, tile latency and access rates of the tile store
+    store_match = re.search(r'store: codec=(\S+) ; cache=\d+ tiles ; ratio=([\d\.]+) ; stored=[\d\.]+ MB of [\d\.]+ MB ;'
+                            r' mean_compress=[\d\.]+ s ; tile_latency=([\d\.]+) us ; hit_rate=([\d\.]+) ;'
+                            r' access: plain=([\d\.]+) store=([\d\.]+) Mparticles/s', content)
+    if store_match:
+        data['store_codec'] = store_match.group(1)
+        data['store_ratio'] = float(store_match.group(2))
+        data['tile_latency'] = float(store_match.group(3))
+        data['store_hit_rate'] = float(store_match.group(4))
+        data['store_rates'] = (float(store_match.group(5)), float(store_match.group(6)))
+    
+    # Extract the bytes per step and the cost of the delta cache against netCDF
+    delta_match = re.search(r'delta: keyframe=(\d+) ; quant=(\S+) ; bytes_per_step: netcdf=([\d\.]+) MB cache=([\d\.]+) MB'
+                            r' keyframe=[\d\.]+ MB delta=[\d\.]+ MB ; mean_convert=[\d\.]+ s ; mean_read=([\d\.]+) s ;'
+                            r' mean_reconstruct=([\d\.]+) s ; mean_netcdf=([\d\.]+) s ; max_error=(\S+)', content)
+    if delta_match:
+        data['delta'] = {'keyframe': int(delta_match.group(1)), 'quant': float(delta_match.group(2)),
+                         'netcdf_mb': float(delta_match.group(3)), 'cache_mb': float(delta_match.group(4)),
+                         'read': float(delta_match.group(5)), 'reconstruct': float(delta_match.group(6)),
+                         'netcdf': float(delta_match.group(7)), 'error': float(delta_match.group(8))}
+    
+    # Extract the conversion and read times of the Zarr chunk stores against netCDF
+    zarr_match = re.search(r'zarr: threads=(\d+) ; chunks_per_file=([\d\.]+) ; fetched_per_file=([\d\.]+) MB ;'
+                           r' mean_zarr=([\d\.]+) s ; mean_netcdf=([\d\.]+) s ; speedup=([\d\.]+)', content)
+    if zarr_match:
+        data['zarr'] = {'threads': int(zarr_match.group(1)), 'chunks': float(zarr_match.group(2)),
+                        'fetched_mb': float(zarr_match.group(3)), 'zarr': float(zarr_match.group(4)),
+                        'netcdf': float(zarr_match.group(5)), 'speedup': float(zarr_match.group(6)),
+                        'codec': None, 'convert': None, 'ratio': None}
+        convert_match = re.search(r'zarr_convert: codec=(\S+) ; chunk_edge=\d+ ; total_time=([\d\.]+) s ;'
+                                  r' stored=[\d\.]+ MB of [\d\.]+ MB ; ratio=([\d\.]+)', content)
+        if convert_match:
+            data['zarr'].update(codec=convert_match.group(1), convert=float(convert_match.group(2)),
+                                ratio=float(convert_match.group(3)))
+    
+    # Extract the bytes skipped and read times of the sparse HDF5 path per variable
+    for var, skipped_mb, total_mb, sparse, read, speedup in re.findall(
+            r'sparse: var=(\S+) ; skipped=([\d\.]+) MB of ([\d\.]+) MB ; mean_sparse=([\d\.]+) s ;'
+            r' mean_read=([\d\.]+) s ; speedup=([\d\.]+)', content):
+        data['sparse'][var] = {'skipped_mb': float(skipped_mb), 'total_mb': float(total_mb), 'sparse': float(sparse),
+                               'read': float(read), 'speedup': float(speedup)}
+    
+    # Extract file-parallel aggregate bandwidth (MB/s over all files and groups)
+    aggregate_match = re.search(r'file_groups=(\d+) ; total_time=[\d\.]+ s ; aggregate_bandwidth=([\d\.]+) MB/s', content)
+    if aggregate_match:
+        data['file_groups'] = int(aggregate_match.group(1))
+        data['aggregate_bandwidth'] = float(aggregate_match.group(2))
+    
     # Extract number of files
     files_match = re.search(r'Number of files: (\d+)', content)
     if files_match:
@@ -122,6 +313,52 @@ def calculate_statistics(parsed_data):
             'halo_size': data['halo_size'],
             'process_grid': data['process_grid'],
             'independent_access': data['independent_access'],
+            'read_mode': data['read_mode'],
+            'open_time': data['open_time'],
+            'first_read_time': data['first_read_time'],
+            'opens_per_sec': data['opens_per_sec'],
+            'open_latency_p99': data['open_latency_p99'],
+            'throttle': data['throttle'],
+            'mean_wait': data['mean_wait'],
+            'steal': data['steal'],
+            'mean_idle': data['mean_idle'],
+            'mean_makespan': data['mean_makespan'],
+            'io_servers': data['io_servers'],
+            'mean_stall': data['mean_stall'],
+            'members': data['members'],
+            'shared_read': data['shared_read'],
+            'effective_bandwidth': data['effective_bandwidth'],
+            'jobs': data['jobs'],
+            'job_files': data['job_files'],
+            'mean_slowdown': data['mean_slowdown'],
+            'max_slowdown': data['max_slowdown'],
+            'levels': data['levels'],
+            'level_saved_mb': data['level_saved_mb'],
+            'layout': data['layout'],
+            'layout_method': data['layout_method'],
+            'mean_transpose': data['mean_transpose'],
+            'transform': data['transform'],
+            'mean_transform': data['mean_transform'],
+            'interp_speedup': data['interp_speedup'],
+            'break_even': data['break_even'],
+            'particles': data['particles'],
+            'interp_rates': data['interp_rates'],
+            'tile_edge': data['tile_edge'],
+            'mean_tiling': data['mean_tiling'],
+            'pages_row_major': data['pages_row_major'],
+            'pages_tiled': data['pages_tiled'],
+            'half': data['half'],
+            'store_codec': data['store_codec'],
+            'store_ratio': data['store_ratio'],
+            'tile_latency': data['tile_latency'],
+            'store_hit_rate': data['store_hit_rate'],
+            'store_rates': data['store_rates'],
+            'delta': data['delta'],
+            'zarr': data['zarr'],
+            'sparse': data['sparse'],
+            'grid_auto': data['grid_auto'],
+            'file_groups': data['file_groups'],
+            'aggregate_bandwidth': data['aggregate_bandwidth'],
             'num_files': data['num_files'],
             'filesize_bytes': data['filesize'],
             'filesize_mb': data['filesize'] / (1024 * 1024) if data['filesize'] else None,
@@ -160,9 +397,69 @@ def print_statistics(stats):
         grid = f"{file_stat['process_grid'][0]}x{file_stat['process_grid'][1]}" if file_stat['process_grid'] else "N/A"
         halo = file_stat['halo_size'] if file_stat['halo_size'] is not None else "N/A"
         access = "ind" if file_stat['independent_access'] else "col"
-        config = f"{grid}, h={halo}, {access}"
+        config = f"{grid}{' auto' if file_stat['grid_auto'] else ''}, h={halo}, {access}"
+        if file_stat['read_mode'] not in (None, 'direct'):
+            config += f", {file_stat['read_mode']}"
+        if file_stat['file_groups']:
+            config += f", G={file_stat['file_groups']}"
+        if file_stat['throttle']:
+            config += f", K={file_stat['throttle']}"
+        if file_stat['steal'] is not None:
+            config += ", dynamic" if file_stat['steal'] else ", static"
+        if file_stat['io_servers']:
+            config += f", M={file_stat['io_servers']}"
+        if file_stat['members']:
+            config += f", E={file_stat['members']}" + (", shared" if file_stat['shared_read'] else ", independent")
+        if file_stat['jobs']:
+            config += f", J={file_stat['jobs']} {file_stat['job_files']}"
+        if file_stat['levels']:
+            config += f", lev={file_stat['levels']}"
+        if file_stat['layout']:
+            config += f", {file_stat['layout_method']}"
+        if file_stat['transform']:
+            config += f", T={file_stat['transform']}"
         
         print(f"{log_name:<23} | {mean_time:8.6f} | {std_time:8.6f} | {filesize_mb:8.1f} | {io_speed:11.2f} | {num_files:5d} | {config}")
+        if file_stat['open_time'] is not None:
+            print(f"{'':<23}   open latency: {file_stat['open_time']:.6f} s, first read latency: {file_stat['first_read_time']:.6f} s")
+        if file_stat['mean_wait'] is not None:
+            print(f"{'':<23}   mean token wait per rank and file: {file_stat['mean_wait']:.6f} s")
+        if file_stat['mean_idle'] is not None:
+            print(f"{'':<23}   mean idle time per rank: {file_stat['mean_idle']:.6f} s, mean makespan: {file_stat['mean_makespan']:.6f} s")
+        if file_stat['mean_stall'] is not None:
+            print(f"{'':<23}   mean compute stall per rank and file: {file_stat['mean_stall']:.6f} s")
+        if file_stat['opens_per_sec'] is not None:
+            print(f"{'':<23}   metadata: {file_stat['opens_per_sec']:.2f} opens/s, p99 open cycle latency: {file_stat['open_latency_p99']:.6f} s")
+        if file_stat['level_saved_mb'] is not None:
+            print(f"{'':<23}   level window saves {file_stat['level_saved_mb']:.1f} MB of chunk reads per file")
+        if file_stat['mean_transpose'] is not None:
+            print(f"{'':<23}   layout {file_stat['layout']} ({file_stat['layout_method']}), mean transpose: {file_stat['mean_transpose']:.6f} s")
+        if file_stat['mean_transform'] is not None:
+            print(f"{'':<23}   transform {file_stat['transform']}: {file_stat['mean_transform']:.6f} s, interpolation speed-up {file_stat['interp_speedup']:.3f}, break-even after {file_stat['break_even']} probes")
+        if file_stat['interp_rates']:
+            rates = ", ".join(f"{k} {v:.1f}" for k, v in file_stat['interp_rates'].items())
+            print(f"{'':<23}   interpolation of {file_stat['particles']} particles (Mparticles/s): {rates}")
+        if file_stat['tile_edge'] is not None:
+            print(f"{'':<23}   tiles of {file_stat['tile_edge']}^3: tiling {file_stat['mean_tiling']:.6f} s, pages per particle {file_stat['pages_row_major']:.3f} row-major vs {file_stat['pages_tiled']:.3f} tiled")
+        for fmt, h in file_stat['half'].items():
+            print(f"{'':<23}   {fmt}: {h['level_mb']:.1f} -> {h['half_mb']:.1f} MB per time level, encode {h['encode']:.6f} s, decode {h['decode']:.6f} s, error {h['field_error']:.2e} (fields) {h['interp_error']:.2e} (interpolated), {h['overflows']} overflows")
+        if file_stat['store_codec'] is not None:
+            print(f"{'':<23}   store {file_stat['store_codec']}: ratio {file_stat['store_ratio']:.3f}, {file_stat['tile_latency']:.3f} us per tile, hit rate {file_stat['store_hit_rate']:.3f}, {file_stat['store_rates'][1]:.3f} vs {file_stat['store_rates'][0]:.3f} Mparticles/s uncompressed")
+        if file_stat['delta'] is not None:
+            d = file_stat['delta']
+            print(f"{'':<23}   delta cache (keyframe {d['keyframe']}, quant {d['quant']:g}): {d['cache_mb']:.3f} vs {d['netcdf_mb']:.3f} MB per step, read+reconstruct {d['read'] + d['reconstruct']:.6f} s vs netCDF {d['netcdf']:.6f} s, max error {d['error']:.2e}")
+        if file_stat['zarr'] is not None:
+            z = file_stat['zarr']
+            converted = f", converted with {z['codec']} in {z['convert']:.6f} s (ratio {z['ratio']:.3f})" if z['codec'] else ""
+            print(f"{'':<23}   zarr ({z['threads']} threads): {z['chunks']:.1f} chunks, {z['fetched_mb']:.3f} MB per file, {z['zarr']:.6f} s vs netCDF {z['netcdf']:.6f} s, speedup {z['speedup']:.3f}{converted}")
+        for var, sp in file_stat['sparse'].items():
+            print(f"{'':<23}   sparse {var}: skipped {sp['skipped_mb']:.3f} of {sp['total_mb']:.3f} MB, {sp['sparse']:.6f} s vs {sp['read']:.6f} s, speedup {sp['speedup']:.3f}")
+        if file_stat['mean_slowdown'] is not None:
+            print(f"{'':<23}   slowdown against solo runs: mean {file_stat['mean_slowdown']:.3f}, max {file_stat['max_slowdown']:.3f}")
+        if file_stat['effective_bandwidth']:
+            print(f"{'':<23}   effective bandwidth over all members: {file_stat['effective_bandwidth']:.2f} MB/s")
+        if file_stat['aggregate_bandwidth']:
+            print(f"{'':<23}   aggregate bandwidth over all groups: {file_stat['aggregate_bandwidth']:.2f} MB/s")
     
     print()
 
@@ -183,7 +480,27 @@ def plot_statistics(stats,path):
         grid = f"{file_stat['process_grid'][0]}x{file_stat['process_grid'][1]}" if file_stat['process_grid'] else "N/A"
         halo = file_stat['halo_size'] if file_stat['halo_size'] is not None else "N/A"
         access = "ind" if file_stat['independent_access'] else "col"
-        config = f"{grid}, h={halo}, {access}"
+        config = f"{grid}{' auto' if file_stat['grid_auto'] else ''}, h={halo}, {access}"
+        if file_stat['read_mode'] not in (None, 'direct'):
+            config += f", {file_stat['read_mode']}"
+        if file_stat['file_groups']:
+            config += f", G={file_stat['file_groups']}"
+        if file_stat['throttle']:
+            config += f", K={file_stat['throttle']}"
+        if file_stat['steal'] is not None:
+            config += ", dynamic" if file_stat['steal'] else ", static"
+        if file_stat['io_servers']:
+            config += f", M={file_stat['io_servers']}"
+        if file_stat['members']:
+            config += f", E={file_stat['members']}" + (", shared" if file_stat['shared_read'] else ", independent")
+        if file_stat['jobs']:
+            config += f", J={file_stat['jobs']} {file_stat['job_files']}"
+        if file_stat['levels']:
+            config += f", lev={file_stat['levels']}"
+        if file_stat['layout']:
+            config += f", {file_stat['layout_method']}"
+        if file_stat['transform']:
+            config += f", T={file_stat['transform']}"
 
         # convert Wed Sep 24 10:19:41 PM CEST 2025 to timestamp
         start_time = datetime.datetime.strptime(file_stat['start_time'], '%a %b %d %I:%M:%S %p %Z %Y') if file_stat['start_time'] else None